@@ -0,0 +1,12 @@
+#pragma once
+
+/* Stand-in for libobs' graphics/vec4.h. */
+
+struct vec4 {
+	float x, y, z, w;
+};
+
+static inline void vec4_zero(struct vec4 *v)
+{
+	v->x = v->y = v->z = v->w = 0.0f;
+}
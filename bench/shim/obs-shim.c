@@ -0,0 +1,1059 @@
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/dstr.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+
+#define SHIM_MAX_SIGNALS 8
+
+struct signal_connection {
+	const char *signal;
+	signal_callback_t callback;
+	void *data;
+};
+
+struct signal_handler {
+	struct signal_connection connections[SHIM_MAX_SIGNALS];
+	size_t num;
+};
+
+
+struct obs_source {
+	char *name;
+	long refs;
+	uint32_t cx;
+	uint32_t cy;
+	long active;
+	uint64_t activated_time;
+	size_t renders;
+	uint32_t output_flags;
+	char *id;
+	char *file;
+	bool from_file;
+
+	enum obs_media_state media_state;
+	int64_t media_time;
+	int64_t media_duration;
+
+	bool is_transition;
+	obs_source_t *transition_a;
+	obs_source_t *transition_b;
+	uint64_t transition_start;
+	uint32_t transition_duration;
+	bool transition_started;
+	uint32_t transition_cx;
+	uint32_t transition_cy;
+
+	struct signal_handler signals;
+
+	obs_source_t *next_in_bucket;
+};
+
+static uint64_t frame_time = 0;
+static uint64_t source_warmup = 0;
+static size_t ref_calls = 0;
+static size_t texture_draws = 0;
+static bool log_enabled = false;
+static obs_hotkey_id next_hotkey_id = 0;
+
+#define SOURCE_BUCKETS 65536
+static obs_source_t *source_buckets[SOURCE_BUCKETS];
+
+/* ------------------------------------------------------------------------- */
+/* bmem: every block carries its size so totals can be reported */
+
+static size_t allocated = 0;
+static size_t peak = 0;
+static long num_allocs = 0;
+
+#define BMEM_HEADER 16
+
+void *bmalloc(size_t size)
+{
+	unsigned char *mem = malloc(size + BMEM_HEADER);
+	if (!mem)
+		abort();
+	*(size_t *)mem = size;
+	const size_t total = __atomic_add_fetch(&allocated, size, __ATOMIC_RELAXED);
+	if (total > peak)
+		peak = total;
+	__atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+	return mem + BMEM_HEADER;
+}
+
+void bfree(void *ptr)
+{
+	if (!ptr)
+		return;
+	unsigned char *mem = (unsigned char *)ptr - BMEM_HEADER;
+	__atomic_sub_fetch(&allocated, *(size_t *)mem, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+	free(mem);
+}
+
+void *brealloc(void *ptr, size_t size)
+{
+	if (!ptr)
+		return bmalloc(size);
+	unsigned char *mem = (unsigned char *)ptr - BMEM_HEADER;
+	const size_t old_size = *(size_t *)mem;
+	mem = realloc(mem, size + BMEM_HEADER);
+	if (!mem)
+		abort();
+	*(size_t *)mem = size;
+	__atomic_sub_fetch(&allocated, old_size, __ATOMIC_RELAXED);
+	const size_t total = __atomic_add_fetch(&allocated, size, __ATOMIC_RELAXED);
+	if (total > peak)
+		peak = total;
+	return mem + BMEM_HEADER;
+}
+
+long bnum_allocs(void)
+{
+	return __atomic_load_n(&num_allocs, __ATOMIC_RELAXED);
+}
+
+size_t shim_bmem_allocated(void)
+{
+	return __atomic_load_n(&allocated, __ATOMIC_RELAXED);
+}
+
+size_t shim_bmem_peak(void)
+{
+	return peak;
+}
+
+/* ------------------------------------------------------------------------- */
+/* logging and platform */
+
+void blog(int log_level, const char *format, ...)
+{
+	UNUSED_PARAMETER(log_level);
+	if (!log_enabled)
+		return;
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+char *os_quick_read_utf8_file(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	char *str = bmalloc((size_t)size + 1);
+	const size_t read = fread(str, 1, (size_t)size, f);
+	str[read] = 0;
+	fclose(f);
+	return str;
+}
+
+bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker)
+{
+	UNUSED_PARAMETER(marker);
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return false;
+	const bool success = fwrite(str, 1, len, f) == len;
+	fclose(f);
+	return success;
+}
+
+bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len, bool marker, const char *temp_ext,
+				   const char *backup_ext)
+{
+	UNUSED_PARAMETER(backup_ext);
+	if (!temp_ext || !*temp_ext)
+		return false;
+	const size_t path_len = strlen(path);
+	char *temp_path = bmalloc(path_len + strlen(temp_ext) + 2);
+	memcpy(temp_path, path, path_len);
+	temp_path[path_len] = '.';
+	strcpy(temp_path + path_len + 1, temp_ext);
+	bool success = os_quick_write_utf8_file(temp_path, str, len, marker) && rename(temp_path, path) == 0;
+	bfree(temp_path);
+	return success;
+}
+
+bool os_file_exists(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return false;
+	fclose(f);
+	return true;
+}
+
+const char *os_get_path_extension(const char *path)
+{
+	const char *ext = path ? strrchr(path, '.') : NULL;
+	const char *slash = path ? strrchr(path, '/') : NULL;
+	return ext && (!slash || ext > slash) ? ext : NULL;
+}
+
+int astrcmpi(const char *str1, const char *str2)
+{
+	return strcasecmp(str1 ? str1 : "", str2 ? str2 : "");
+}
+
+uint64_t os_gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void os_sleep_ms(uint32_t duration)
+{
+	struct timespec ts = {duration / 1000, (long)(duration % 1000) * 1000000L};
+	nanosleep(&ts, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* threading */
+
+struct os_event_data {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	volatile bool signalled;
+	bool manual;
+};
+
+int os_event_init(os_event_t **event, enum os_event_type type)
+{
+	os_event_t *data = bzalloc(sizeof(os_event_t));
+	pthread_mutex_init(&data->mutex, NULL);
+	pthread_cond_init(&data->cond, NULL);
+	data->manual = type == OS_EVENT_TYPE_MANUAL;
+	*event = data;
+	return 0;
+}
+
+void os_event_destroy(os_event_t *event)
+{
+	if (!event)
+		return;
+	pthread_mutex_destroy(&event->mutex);
+	pthread_cond_destroy(&event->cond);
+	bfree(event);
+}
+
+int os_event_wait(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled)
+		pthread_cond_wait(&event->cond, &event->mutex);
+	if (!event->manual)
+		event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+int os_event_timedwait(os_event_t *event, unsigned long milliseconds)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += (time_t)(milliseconds / 1000);
+	ts.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	int code = 0;
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled && code == 0)
+		code = pthread_cond_timedwait(&event->cond, &event->mutex, &ts);
+	if (code == 0 && !event->manual)
+		event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+	return code;
+}
+
+int os_event_try(os_event_t *event)
+{
+	int ret = EAGAIN;
+	pthread_mutex_lock(&event->mutex);
+	if (event->signalled) {
+		if (!event->manual)
+			event->signalled = false;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&event->mutex);
+	return ret;
+}
+
+int os_event_signal(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signalled = true;
+	pthread_cond_signal(&event->cond);
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+void os_event_reset(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* sources */
+
+static size_t name_hash(const char *name)
+{
+	size_t h = 5381;
+	while (*name)
+		h = h * 33 + (unsigned char)*name++;
+	return h % SOURCE_BUCKETS;
+}
+
+static obs_source_t *source_create(const char *name)
+{
+	obs_source_t *source = bzalloc(sizeof(obs_source_t));
+	source->name = bstrdup(name);
+	source->refs = 1;
+	source->output_flags = OBS_SOURCE_VIDEO;
+	return source;
+}
+
+obs_source_t *shim_source_create(const char *name, uint32_t cx, uint32_t cy)
+{
+	obs_source_t *source = source_create(name);
+	source->cx = cx;
+	source->cy = cy;
+	const size_t bucket = name_hash(name);
+	source->next_in_bucket = source_buckets[bucket];
+	source_buckets[bucket] = source;
+	source->refs++;
+	return source;
+}
+
+obs_source_t *shim_private_source_create(const char *name)
+{
+	return source_create(name);
+}
+
+obs_source_t *shim_transition_create(const char *name)
+{
+	obs_source_t *transition = source_create(name);
+	transition->is_transition = true;
+	return transition;
+}
+
+void shim_source_set_media(obs_source_t *source, enum obs_media_state state, int64_t time, int64_t duration)
+{
+	source->media_state = state;
+	source->media_time = time;
+	source->media_duration = duration;
+}
+
+void shim_set_video_frame_time(uint64_t ts)
+{
+	frame_time = ts;
+}
+
+void shim_set_log_enabled(bool enabled)
+{
+	log_enabled = enabled;
+}
+
+size_t shim_source_render_count(const obs_source_t *source)
+{
+	return source ? source->renders : 0;
+}
+
+void shim_set_source_warmup(uint64_t ns)
+{
+	source_warmup = ns;
+}
+
+bool shim_source_ready(const obs_source_t *source)
+{
+	return source && source->active && frame_time - source->activated_time >= source_warmup;
+}
+
+size_t shim_ref_calls(void)
+{
+	return ref_calls;
+}
+
+long shim_source_refs(const obs_source_t *source)
+{
+	return source ? source->refs : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* profiler: names are kept until shutdown like the libobs name store */
+
+struct profiler_name_store {
+	char **names;
+	size_t num;
+};
+
+static profiler_name_store_t name_store = {NULL, 0};
+
+profiler_name_store_t *obs_get_profiler_name_store(void)
+{
+	return &name_store;
+}
+
+const char *profile_store_name(profiler_name_store_t *store, const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	store->names = brealloc(store->names, sizeof(char *) * (store->num + 1));
+	store->names[store->num] = bstrdup(buffer);
+	return store->names[store->num++];
+}
+
+void profile_start(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+void profile_end(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+void shim_shutdown(void)
+{
+	for (size_t i = 0; i < name_store.num; i++)
+		bfree(name_store.names[i]);
+	bfree(name_store.names);
+	name_store.names = NULL;
+	name_store.num = 0;
+
+	for (size_t i = 0; i < SOURCE_BUCKETS; i++) {
+		obs_source_t *source = source_buckets[i];
+		source_buckets[i] = NULL;
+		while (source) {
+			obs_source_t *next = source->next_in_bucket;
+			obs_source_release(source);
+			source = next;
+		}
+	}
+}
+
+uint64_t obs_get_video_frame_time(void)
+{
+	return frame_time;
+}
+
+uint64_t obs_get_frame_interval_ns(void)
+{
+	return 16666667ULL;
+}
+
+obs_source_t *obs_get_source_by_name(const char *name)
+{
+	if (!name)
+		return NULL;
+	for (obs_source_t *source = source_buckets[name_hash(name)]; source; source = source->next_in_bucket) {
+		if (strcmp(source->name, name) == 0)
+			return obs_source_get_ref(source);
+	}
+	return NULL;
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source)
+{
+	ref_calls++;
+	if (source)
+		source->refs++;
+	return source;
+}
+
+void obs_source_release(obs_source_t *source)
+{
+	if (!source || --source->refs)
+		return;
+	if (source->is_transition)
+		obs_transition_clear(source);
+	bfree(source->name);
+	bfree(source->id);
+	bfree(source->file);
+	bfree(source);
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? source->name : NULL;
+}
+
+bool obs_source_removed(const obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+	return false;
+}
+
+uint32_t obs_source_get_width(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	return source->is_transition ? source->transition_cx : source->cx;
+}
+
+uint32_t obs_source_get_height(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	return source->is_transition ? source->transition_cy : source->cy;
+}
+
+bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	UNUSED_PARAMETER(parent);
+	if (!child)
+		return false;
+	if (!child->active++)
+		child->activated_time = frame_time;
+	return true;
+}
+
+void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	UNUSED_PARAMETER(parent);
+	if (child && child->active)
+		child->active--;
+}
+
+static void source_signal(obs_source_t *source, const char *signal)
+{
+	calldata_t cd;
+	calldata_init(&cd);
+	calldata_set_ptr(&cd, "source", source);
+	signal_handler_signal(&source->signals, signal, &cd);
+	calldata_free(&cd);
+}
+
+void obs_source_video_render(obs_source_t *source)
+{
+	if (!source)
+		return;
+	source->renders++;
+	if (!source->is_transition)
+		return;
+	if (obs_transition_get_time(source) >= 1.0f && source->transition_started) {
+		/* like libobs, a finished auto transition swaps B into A */
+		source->transition_started = false;
+		obs_source_release(source->transition_a);
+		source->transition_a = source->transition_b;
+		source->transition_b = NULL;
+		obs_source_video_render(source->transition_a);
+		source_signal(source, "transition_stop");
+		return;
+	}
+	obs_source_video_render(source->transition_a);
+	obs_source_video_render(source->transition_b);
+}
+
+uint32_t obs_source_get_output_flags(const obs_source_t *source)
+{
+	return source ? source->output_flags : 0;
+}
+
+void shim_source_set_output_flags(obs_source_t *source, uint32_t flags)
+{
+	source->output_flags = flags;
+}
+
+const char *obs_source_get_unversioned_id(const obs_source_t *source)
+{
+	return source ? source->id : NULL;
+}
+
+void shim_source_set_id(obs_source_t *source, const char *id)
+{
+	bfree(source->id);
+	source->id = bstrdup(id);
+}
+
+void shim_source_set_file(obs_source_t *source, const char *file)
+{
+	bfree(source->file);
+	source->file = bstrdup(file);
+}
+
+void shim_source_set_from_file(obs_source_t *source, bool from_file)
+{
+	source->from_file = from_file;
+}
+
+/* the settings of a source are the source itself, only "file" and reading text from it are known */
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+	return (obs_data_t *)source;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+	const obs_source_t *source = (const obs_source_t *)data;
+	return source && source->file && strcmp(name, "file") == 0 ? source->file : "";
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+	const obs_source_t *source = (const obs_source_t *)data;
+	return source && source->from_file && (strcmp(name, "from_file") == 0 || strcmp(name, "read_from_file") == 0);
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+void shim_source_update(obs_source_t *source)
+{
+	source_signal(source, "update");
+}
+
+bool obs_source_active(const obs_source_t *source)
+{
+	return source && source->active > 0;
+}
+
+bool obs_source_showing(const obs_source_t *source)
+{
+	return source != NULL;
+}
+
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
+{
+	return source ? (signal_handler_t *)&source->signals : NULL;
+}
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
+{
+	if (!handler || handler->num == SHIM_MAX_SIGNALS)
+		abort();
+	handler->connections[handler->num++] = (struct signal_connection){signal, callback, data};
+}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
+{
+	if (!handler)
+		return;
+	for (size_t i = 0; i < handler->num; i++) {
+		const struct signal_connection *connection = &handler->connections[i];
+		if (strcmp(connection->signal, signal) == 0 && connection->callback == callback && connection->data == data) {
+			handler->connections[i] = handler->connections[--handler->num];
+			return;
+		}
+	}
+}
+
+bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
+{
+	UNUSED_PARAMETER(handler);
+	UNUSED_PARAMETER(signal_decl);
+	return true;
+}
+
+bool signal_handler_add_array(signal_handler_t *handler, const char **signal_decls)
+{
+	UNUSED_PARAMETER(handler);
+	UNUSED_PARAMETER(signal_decls);
+	return true;
+}
+
+void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params)
+{
+	if (!handler)
+		return;
+	for (size_t i = 0; i < handler->num; i++) {
+		const struct signal_connection *connection = &handler->connections[i];
+		if (strcmp(connection->signal, signal) == 0)
+			connection->callback(connection->data, params);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* calldata: fixed size records, strings are copied unless the stack is fixed */
+
+struct calldata_item {
+	char name[32];
+	long long i;
+	double f;
+	void *p;
+	char *s;
+};
+
+#define CALLDATA_DEFAULT_ITEMS 16
+
+void calldata_init(calldata_t *data)
+{
+	data->capacity = CALLDATA_DEFAULT_ITEMS * sizeof(struct calldata_item);
+	data->stack = bzalloc(data->capacity);
+	data->size = 0;
+	data->fixed = false;
+}
+
+void calldata_init_fixed(calldata_t *data, uint8_t *stack, size_t size)
+{
+	data->stack = stack;
+	data->capacity = size;
+	data->size = 0;
+	data->fixed = true;
+}
+
+void calldata_free(calldata_t *data)
+{
+	if (data->fixed)
+		return;
+	struct calldata_item *items = (struct calldata_item *)data->stack;
+	for (size_t i = 0; i < data->size / sizeof(struct calldata_item); i++)
+		bfree(items[i].s);
+	bfree(data->stack);
+	data->stack = NULL;
+}
+
+static struct calldata_item *calldata_find(const calldata_t *data, const char *name)
+{
+	struct calldata_item *items = (struct calldata_item *)data->stack;
+	for (size_t i = 0; i < data->size / sizeof(struct calldata_item); i++) {
+		if (strcmp(items[i].name, name) == 0)
+			return &items[i];
+	}
+	return NULL;
+}
+
+static struct calldata_item *calldata_item(calldata_t *data, const char *name)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (item)
+		return item;
+	if (data->size + sizeof(struct calldata_item) > data->capacity) {
+		if (data->fixed)
+			abort();
+		data->capacity *= 2;
+		data->stack = brealloc(data->stack, data->capacity);
+	}
+	item = (struct calldata_item *)(data->stack + data->size);
+	data->size += sizeof(struct calldata_item);
+	memset(item, 0, sizeof(*item));
+	strncpy(item->name, name, sizeof(item->name) - 1);
+	return item;
+}
+
+void calldata_set_int(calldata_t *data, const char *name, long long val)
+{
+	calldata_item(data, name)->i = val;
+}
+
+void calldata_set_float(calldata_t *data, const char *name, double val)
+{
+	calldata_item(data, name)->f = val;
+}
+
+void calldata_set_bool(calldata_t *data, const char *name, bool val)
+{
+	calldata_item(data, name)->i = val;
+}
+
+void calldata_set_ptr(calldata_t *data, const char *name, void *ptr)
+{
+	calldata_item(data, name)->p = ptr;
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+	struct calldata_item *item = calldata_item(data, name);
+	if (data->fixed) {
+		item->s = (char *)str;
+		return;
+	}
+	bfree(item->s);
+	item->s = str ? bstrdup(str) : NULL;
+}
+
+long long calldata_int(const calldata_t *data, const char *name)
+{
+	const struct calldata_item *item = calldata_find(data, name);
+	return item ? item->i : 0;
+}
+
+double calldata_float(const calldata_t *data, const char *name)
+{
+	const struct calldata_item *item = calldata_find(data, name);
+	return item ? item->f : 0.0;
+}
+
+bool calldata_bool(const calldata_t *data, const char *name)
+{
+	return calldata_int(data, name) != 0;
+}
+
+void *calldata_ptr(const calldata_t *data, const char *name)
+{
+	const struct calldata_item *item = calldata_find(data, name);
+	return item ? item->p : NULL;
+}
+
+const char *calldata_string(const calldata_t *data, const char *name)
+{
+	const struct calldata_item *item = calldata_find(data, name);
+	return item ? item->s : NULL;
+}
+
+enum obs_media_state obs_source_media_get_state(obs_source_t *source)
+{
+	return source ? source->media_state : OBS_MEDIA_STATE_NONE;
+}
+
+int64_t obs_source_media_get_duration(obs_source_t *source)
+{
+	return source ? source->media_duration : 0;
+}
+
+int64_t obs_source_media_get_time(obs_source_t *source)
+{
+	return source ? source->media_time : 0;
+}
+
+void obs_source_media_set_time(obs_source_t *source, int64_t ms)
+{
+	if (source)
+		source->media_time = ms;
+}
+
+void obs_source_media_restart(obs_source_t *source)
+{
+	if (!source)
+		return;
+	source->media_time = 0;
+	source->media_state = OBS_MEDIA_STATE_PLAYING;
+}
+
+/* ------------------------------------------------------------------------- */
+/* graphics: texrenders only remember their size, drawing is counted */
+
+struct gs_texrender {
+	uint32_t cx;
+	uint32_t cy;
+	bool rendered;
+};
+
+void obs_enter_graphics(void) {}
+
+void obs_leave_graphics(void) {}
+
+gs_texrender_t *gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format zsformat)
+{
+	UNUSED_PARAMETER(format);
+	UNUSED_PARAMETER(zsformat);
+	return bzalloc(sizeof(gs_texrender_t));
+}
+
+void gs_texrender_destroy(gs_texrender_t *texrender)
+{
+	bfree(texrender);
+}
+
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	if (!texrender || texrender->rendered || !cx || !cy)
+		return false;
+	texrender->cx = cx;
+	texrender->cy = cy;
+	return true;
+}
+
+void gs_texrender_end(gs_texrender_t *texrender)
+{
+	texrender->rendered = true;
+}
+
+void gs_texrender_reset(gs_texrender_t *texrender)
+{
+	if (texrender)
+		texrender->rendered = false;
+}
+
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender)
+{
+	return texrender && texrender->rendered ? (gs_texture_t *)texrender : NULL;
+}
+
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth, uint8_t stencil)
+{
+	UNUSED_PARAMETER(clear_flags);
+	UNUSED_PARAMETER(color);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+}
+
+void gs_ortho(float left, float right, float top, float bottom, float znear, float zfar)
+{
+	UNUSED_PARAMETER(left);
+	UNUSED_PARAMETER(right);
+	UNUSED_PARAMETER(top);
+	UNUSED_PARAMETER(bottom);
+	UNUSED_PARAMETER(znear);
+	UNUSED_PARAMETER(zfar);
+}
+
+void gs_blend_state_push(void) {}
+
+void gs_blend_state_pop(void) {}
+
+void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest)
+{
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(dest);
+}
+
+/* the default effect with its image param, a loop runs its single pass once */
+struct gs_effect {
+	gs_texture_t *image;
+	bool looping;
+};
+
+static struct gs_effect default_effect;
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect)
+{
+	return effect == OBS_EFFECT_DEFAULT ? &default_effect : NULL;
+}
+
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name)
+{
+	return effect && strcmp(name, "image") == 0 ? (gs_eparam_t *)&effect->image : NULL;
+}
+
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val)
+{
+	if (param)
+		*(gs_texture_t **)param = val;
+}
+
+bool gs_effect_loop(gs_effect_t *effect, const char *name)
+{
+	if (!effect || strcmp(name, "Draw") != 0)
+		return false;
+	effect->looping = !effect->looping;
+	return effect->looping;
+}
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+	UNUSED_PARAMETER(flip);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	if (tex && default_effect.looping && default_effect.image == tex)
+		texture_draws++;
+}
+
+size_t shim_texture_draws(void)
+{
+	return texture_draws;
+}
+
+/* ------------------------------------------------------------------------- */
+/* transitions */
+
+obs_source_t *obs_transition_get_source(obs_source_t *transition, enum obs_transition_target target)
+{
+	if (!transition)
+		return NULL;
+	return obs_source_get_ref(target == OBS_TRANSITION_SOURCE_A ? transition->transition_a : transition->transition_b);
+}
+
+void obs_transition_clear(obs_source_t *transition)
+{
+	if (!transition)
+		return;
+	obs_source_release(transition->transition_a);
+	obs_source_release(transition->transition_b);
+	transition->transition_a = NULL;
+	transition->transition_b = NULL;
+	transition->transition_started = false;
+}
+
+void obs_transition_set(obs_source_t *transition, obs_source_t *source)
+{
+	if (!transition)
+		return;
+	obs_transition_clear(transition);
+	transition->transition_a = obs_source_get_ref(source);
+}
+
+bool obs_transition_start(obs_source_t *transition, enum obs_transition_mode mode, uint32_t duration_ms, obs_source_t *dest)
+{
+	UNUSED_PARAMETER(mode);
+	if (!transition)
+		return false;
+	obs_source_release(transition->transition_b);
+	transition->transition_b = obs_source_get_ref(dest);
+	transition->transition_start = frame_time;
+	transition->transition_duration = duration_ms;
+	transition->transition_started = true;
+	return true;
+}
+
+void obs_transition_force_stop(obs_source_t *transition)
+{
+	if (!transition)
+		return;
+	transition->transition_started = false;
+	source_signal(transition, "transition_stop");
+}
+
+float obs_transition_get_time(obs_source_t *transition)
+{
+	if (!transition || !transition->transition_started)
+		return 1.0f;
+	if (frame_time <= transition->transition_start)
+		return 0.0f;
+	if (!transition->transition_duration)
+		return 1.0f;
+	const float t = (float)(frame_time - transition->transition_start) / 1000000.0f / (float)transition->transition_duration;
+	return t > 1.0f ? 1.0f : t;
+}
+
+void obs_transition_set_size(obs_source_t *transition, uint32_t cx, uint32_t cy)
+{
+	if (!transition)
+		return;
+	transition->transition_cx = cx;
+	transition->transition_cy = cy;
+}
+
+void obs_transition_get_size(const obs_source_t *transition, uint32_t *cx, uint32_t *cy)
+{
+	*cx = transition ? transition->transition_cx : 0;
+	*cy = transition ? transition->transition_cy : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* hotkeys */
+
+obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+					 obs_hotkey_func func, void *data)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(func);
+	UNUSED_PARAMETER(data);
+	return next_hotkey_id++;
+}
+
+void obs_hotkey_unregister(obs_hotkey_id id)
+{
+	UNUSED_PARAMETER(id);
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+/* Minimal stand-in for libobs, just enough of the source, transition and
+ * hotkey API for the switcher core to run headless in the benchmark.
+ * Declarations follow libobs so the core compiles unchanged against both. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/bmem.h"
+#include "util/profiler.h"
+#include "graphics/vec4.h"
+
+#define UNUSED_PARAMETER(param) (void)param
+
+#define LOG_ERROR 100
+#define LOG_WARNING 200
+#define LOG_INFO 300
+#define LOG_DEBUG 400
+
+void blog(int log_level, const char *format, ...);
+
+profiler_name_store_t *obs_get_profiler_name_store(void);
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_hotkey obs_hotkey_t;
+typedef struct gs_effect gs_effect_t;
+typedef struct gs_texrender gs_texrender_t;
+typedef struct gs_texture gs_texture_t;
+typedef struct gs_effect_param gs_eparam_t;
+typedef struct obs_data obs_data_t;
+typedef size_t obs_hotkey_id;
+typedef struct calldata calldata_t;
+typedef struct signal_handler signal_handler_t;
+typedef void (*signal_callback_t)(void *data, calldata_t *cd);
+
+#define OBS_INVALID_HOTKEY_ID (~(obs_hotkey_id)0)
+
+typedef void (*obs_hotkey_func)(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+
+enum obs_media_state {
+	OBS_MEDIA_STATE_NONE,
+	OBS_MEDIA_STATE_PLAYING,
+	OBS_MEDIA_STATE_OPENING,
+	OBS_MEDIA_STATE_BUFFERING,
+	OBS_MEDIA_STATE_PAUSED,
+	OBS_MEDIA_STATE_STOPPED,
+	OBS_MEDIA_STATE_ENDED,
+	OBS_MEDIA_STATE_ERROR,
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+#define OBS_SOURCE_ASYNC (1 << 2)
+#define OBS_SOURCE_CONTROLLABLE_MEDIA (1 << 13)
+
+enum gs_color_format { GS_RGBA = 3 };
+enum gs_zstencil_format { GS_ZS_NONE };
+enum gs_blend_type { GS_BLEND_ZERO, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA = 7 };
+
+#define GS_CLEAR_COLOR (1 << 0)
+
+enum obs_base_effect { OBS_EFFECT_DEFAULT };
+
+enum obs_transition_target {
+	OBS_TRANSITION_SOURCE_A,
+	OBS_TRANSITION_SOURCE_B,
+};
+
+enum obs_transition_mode {
+	OBS_TRANSITION_MODE_AUTO,
+	OBS_TRANSITION_MODE_MANUAL,
+};
+
+uint64_t obs_get_video_frame_time(void);
+uint64_t obs_get_frame_interval_ns(void);
+
+obs_source_t *obs_get_source_by_name(const char *name);
+obs_source_t *obs_source_get_ref(obs_source_t *source);
+void obs_source_release(obs_source_t *source);
+const char *obs_source_get_name(const obs_source_t *source);
+bool obs_source_removed(const obs_source_t *source);
+uint32_t obs_source_get_width(obs_source_t *source);
+uint32_t obs_source_get_height(obs_source_t *source);
+bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child);
+void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child);
+void obs_source_video_render(obs_source_t *source);
+uint32_t obs_source_get_output_flags(const obs_source_t *source);
+const char *obs_source_get_unversioned_id(const obs_source_t *source);
+obs_data_t *obs_source_get_settings(const obs_source_t *source);
+bool obs_source_active(const obs_source_t *source);
+bool obs_source_showing(const obs_source_t *source);
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source);
+
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+void obs_data_release(obs_data_t *data);
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data);
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data);
+bool signal_handler_add(signal_handler_t *handler, const char *signal_decl);
+bool signal_handler_add_array(signal_handler_t *handler, const char **signal_decls);
+void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params);
+
+/* same layout as libobs, the shim keeps name/value records on the stack */
+struct calldata {
+	uint8_t *stack;
+	size_t size;
+	size_t capacity;
+	bool fixed;
+};
+
+void calldata_init(calldata_t *data);
+void calldata_init_fixed(calldata_t *data, uint8_t *stack, size_t size);
+void calldata_free(calldata_t *data);
+void calldata_set_int(calldata_t *data, const char *name, long long val);
+void calldata_set_float(calldata_t *data, const char *name, double val);
+void calldata_set_bool(calldata_t *data, const char *name, bool val);
+void calldata_set_ptr(calldata_t *data, const char *name, void *ptr);
+void calldata_set_string(calldata_t *data, const char *name, const char *str);
+long long calldata_int(const calldata_t *data, const char *name);
+double calldata_float(const calldata_t *data, const char *name);
+bool calldata_bool(const calldata_t *data, const char *name);
+void *calldata_ptr(const calldata_t *data, const char *name);
+const char *calldata_string(const calldata_t *data, const char *name);
+
+enum obs_media_state obs_source_media_get_state(obs_source_t *source);
+int64_t obs_source_media_get_duration(obs_source_t *source);
+int64_t obs_source_media_get_time(obs_source_t *source);
+void obs_source_media_set_time(obs_source_t *source, int64_t ms);
+void obs_source_media_restart(obs_source_t *source);
+
+obs_source_t *obs_transition_get_source(obs_source_t *transition, enum obs_transition_target target);
+void obs_transition_clear(obs_source_t *transition);
+void obs_transition_set(obs_source_t *transition, obs_source_t *source);
+bool obs_transition_start(obs_source_t *transition, enum obs_transition_mode mode, uint32_t duration_ms, obs_source_t *dest);
+void obs_transition_force_stop(obs_source_t *transition);
+float obs_transition_get_time(obs_source_t *transition);
+void obs_transition_set_size(obs_source_t *transition, uint32_t cx, uint32_t cy);
+void obs_transition_get_size(const obs_source_t *transition, uint32_t *cx, uint32_t *cy);
+
+void obs_enter_graphics(void);
+void obs_leave_graphics(void);
+gs_texrender_t *gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format zsformat);
+void gs_texrender_destroy(gs_texrender_t *texrender);
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy);
+void gs_texrender_end(gs_texrender_t *texrender);
+void gs_texrender_reset(gs_texrender_t *texrender);
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth, uint8_t stencil);
+void gs_ortho(float left, float right, float top, float bottom, float znear, float zfar);
+void gs_blend_state_push(void);
+void gs_blend_state_pop(void);
+void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest);
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect);
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name);
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val);
+bool gs_effect_loop(gs_effect_t *effect, const char *name);
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height);
+
+obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+					 obs_hotkey_func func, void *data);
+void obs_hotkey_unregister(obs_hotkey_id id);
+
+/* shim only: creating sources and driving the frame clock */
+obs_source_t *shim_source_create(const char *name, uint32_t cx, uint32_t cy);
+obs_source_t *shim_private_source_create(const char *name);
+obs_source_t *shim_transition_create(const char *name);
+void shim_source_set_media(obs_source_t *source, enum obs_media_state state, int64_t time, int64_t duration);
+void shim_set_video_frame_time(uint64_t ts);
+void shim_set_log_enabled(bool enabled);
+size_t shim_source_render_count(const obs_source_t *source);
+/* a source only has frames once it has been active for the warmup time */
+void shim_set_source_warmup(uint64_t ns);
+bool shim_source_ready(const obs_source_t *source);
+long shim_source_refs(const obs_source_t *source);
+/* number of obs_source_get_ref calls so far */
+size_t shim_ref_calls(void);
+void shim_source_set_output_flags(obs_source_t *source, uint32_t flags);
+/* changes the settings of a source, it signals update like obs_source_update */
+void shim_source_update(obs_source_t *source);
+/* sets the id of a source and the "file" setting it reports, sources have no id by default */
+void shim_source_set_id(obs_source_t *source, const char *id);
+void shim_source_set_file(obs_source_t *source, const char *file);
+/* the "from_file" and "read_from_file" settings of the text sources */
+void shim_source_set_from_file(obs_source_t *source, bool from_file);
+/* number of sprites drawn with a texture inside an effect loop */
+size_t shim_texture_draws(void);
+void shim_shutdown(void);
@@ -0,0 +1,41 @@
+#pragma once
+
+/* Stand-in for libobs' util/bmem.h. Allocations are counted so the
+ * benchmark can report how much memory the switchers hold. */
+
+#include <stddef.h>
+#include <string.h>
+
+void *bmalloc(size_t size);
+void *brealloc(void *ptr, size_t size);
+void bfree(void *ptr);
+long bnum_allocs(void);
+
+static inline void *bzalloc(size_t size)
+{
+	void *mem = bmalloc(size);
+	if (mem)
+		memset(mem, 0, size);
+	return mem;
+}
+
+static inline char *bstrdup_n(const char *str, size_t n)
+{
+	if (!str)
+		return NULL;
+	char *dup = bmalloc(n + 1);
+	memcpy(dup, str, n);
+	dup[n] = 0;
+	return dup;
+}
+
+static inline char *bstrdup(const char *str)
+{
+	if (!str)
+		return NULL;
+	return bstrdup_n(str, strlen(str));
+}
+
+/* shim only */
+size_t shim_bmem_allocated(void);
+size_t shim_bmem_peak(void);
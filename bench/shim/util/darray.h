@@ -0,0 +1,173 @@
+#pragma once
+
+/* Stand-in for libobs' util/darray.h, covering the subset of the da_*
+ * macros the switcher uses with the same semantics. */
+
+#include <string.h>
+#include "bmem.h"
+
+#define DARRAY_INVALID ((size_t)-1)
+
+struct darray {
+	void *array;
+	size_t num;
+	size_t capacity;
+};
+
+#define DARRAY(type)                     \
+	union {                          \
+		struct darray da;        \
+		struct {                 \
+			type *array;     \
+			size_t num;      \
+			size_t capacity; \
+		};                       \
+	}
+
+static inline void darray_init(struct darray *dst)
+{
+	dst->array = NULL;
+	dst->num = 0;
+	dst->capacity = 0;
+}
+
+static inline void darray_free(struct darray *dst)
+{
+	bfree(dst->array);
+	darray_init(dst);
+}
+
+static inline void darray_ensure_capacity(const size_t element_size, struct darray *dst, const size_t new_size)
+{
+	if (new_size <= dst->capacity)
+		return;
+	size_t new_cap = (!dst->capacity) ? new_size : dst->capacity * 2;
+	if (new_size > new_cap)
+		new_cap = new_size;
+	void *ptr = bmalloc(element_size * new_cap);
+	if (dst->array) {
+		if (dst->capacity)
+			memcpy(ptr, dst->array, element_size * dst->capacity);
+		bfree(dst->array);
+	}
+	dst->array = ptr;
+	dst->capacity = new_cap;
+}
+
+static inline void *darray_item(const size_t element_size, const struct darray *da, size_t idx)
+{
+	return (void *)(((unsigned char *)da->array) + element_size * idx);
+}
+
+static inline void darray_reserve(const size_t element_size, struct darray *dst, const size_t capacity)
+{
+	if (capacity == 0 || capacity <= dst->capacity)
+		return;
+	void *ptr = bmalloc(element_size * capacity);
+	if (dst->array) {
+		if (dst->num)
+			memcpy(ptr, dst->array, element_size * dst->num);
+		bfree(dst->array);
+	}
+	dst->array = ptr;
+	dst->capacity = capacity;
+}
+
+static inline void darray_resize(const size_t element_size, struct darray *dst, const size_t size)
+{
+	if (size == dst->num)
+		return;
+	if (size == 0) {
+		dst->num = 0;
+		return;
+	}
+	const size_t old_num = dst->num;
+	darray_ensure_capacity(element_size, dst, size);
+	dst->num = size;
+	if (size > old_num)
+		memset(darray_item(element_size, dst, old_num), 0, element_size * (size - old_num));
+}
+
+static inline size_t darray_push_back(const size_t element_size, struct darray *dst, const void *item)
+{
+	darray_ensure_capacity(element_size, dst, ++dst->num);
+	memcpy(darray_item(element_size, dst, dst->num - 1), item, element_size);
+	return dst->num - 1;
+}
+
+static inline void *darray_push_back_new(const size_t element_size, struct darray *dst)
+{
+	darray_ensure_capacity(element_size, dst, ++dst->num);
+	void *last = darray_item(element_size, dst, dst->num - 1);
+	memset(last, 0, element_size);
+	return last;
+}
+
+static inline void darray_insert(const size_t element_size, struct darray *dst, const size_t idx, const void *item)
+{
+	if (idx == dst->num) {
+		darray_push_back(element_size, dst, item);
+		return;
+	}
+	const size_t move_count = dst->num - idx;
+	darray_ensure_capacity(element_size, dst, ++dst->num);
+	void *new_item = darray_item(element_size, dst, idx);
+	memmove(darray_item(element_size, dst, idx + 1), new_item, move_count * element_size);
+	memcpy(new_item, item, element_size);
+}
+
+static inline void darray_erase(const size_t element_size, struct darray *dst, const size_t idx)
+{
+	if (idx >= dst->num || !--dst->num)
+		return;
+	memmove(darray_item(element_size, dst, idx), darray_item(element_size, dst, idx + 1),
+		element_size * (dst->num - idx));
+}
+
+static inline void darray_pop_back(const size_t element_size, struct darray *dst)
+{
+	if (dst->num)
+		darray_erase(element_size, dst, dst->num - 1);
+}
+
+static inline void darray_copy(const size_t element_size, struct darray *dst, const struct darray *da)
+{
+	if (da->num == 0) {
+		dst->num = 0;
+		return;
+	}
+	darray_resize(element_size, dst, da->num);
+	memcpy(dst->array, da->array, element_size * da->num);
+}
+
+static inline size_t darray_find(const size_t element_size, const struct darray *da, const void *item, const size_t idx)
+{
+	for (size_t i = idx; i < da->num; i++) {
+		if (memcmp((const char *)da->array + element_size * i, item, element_size) == 0)
+			return i;
+	}
+	return DARRAY_INVALID;
+}
+
+static inline void darray_move(struct darray *dst, struct darray *src)
+{
+	darray_free(dst);
+	memcpy(dst, src, sizeof(struct darray));
+	src->array = NULL;
+	src->capacity = 0;
+	src->num = 0;
+}
+
+#define da_init(v) darray_init(&(v).da)
+#define da_free(v) darray_free(&(v).da)
+#define da_end(v) darray_item(sizeof(*(v).array), &(v).da, (v).num ? (v).num - 1 : 0)
+#define da_reserve(v, capacity) darray_reserve(sizeof(*(v).array), &(v).da, capacity)
+#define da_resize(v, size) darray_resize(sizeof(*(v).array), &(v).da, size)
+#define da_copy(dst, src) darray_copy(sizeof(*(dst).array), &(dst).da, &(src).da)
+#define da_move(dst, src) darray_move(&(dst).da, &(src).da)
+#define da_find(v, item, idx) darray_find(sizeof(*(v).array), &(v).da, item, idx)
+#define da_push_back(v, item) darray_push_back(sizeof(*(v).array), &(v).da, item)
+#define da_push_back_new(v) darray_push_back_new(sizeof(*(v).array), &(v).da)
+#define da_insert(v, idx, item) darray_insert(sizeof(*(v).array), &(v).da, idx, item)
+#define da_erase(v, idx) darray_erase(sizeof(*(v).array), &(v).da, idx)
+#define da_pop_back(v) darray_pop_back(sizeof(*(v).array), &(v).da)
@@ -0,0 +1,5 @@
+#pragma once
+
+/* Stand-in for libobs' util/dstr.h. */
+
+int astrcmpi(const char *str1, const char *str2);
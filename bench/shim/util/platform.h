@@ -0,0 +1,19 @@
+#pragma once
+
+/* Stand-in for libobs' util/platform.h. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define os_stat stat
+
+char *os_quick_read_utf8_file(const char *path);
+bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker);
+bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len, bool marker, const char *temp_ext,
+				   const char *backup_ext);
+bool os_file_exists(const char *path);
+uint64_t os_gettime_ns(void);
+void os_sleep_ms(uint32_t duration);
+const char *os_get_path_extension(const char *path);
@@ -0,0 +1,9 @@
+#pragma once
+
+/* profiler subset used by the switcher core, scopes are not recorded */
+
+typedef struct profiler_name_store profiler_name_store_t;
+
+void profile_start(const char *name);
+void profile_end(const char *name);
+const char *profile_store_name(profiler_name_store_t *store, const char *format, ...);
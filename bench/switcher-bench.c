@@ -0,0 +1,976 @@
+/* Headless benchmark for the switcher core.
+ *
+ * Runs the switching state machine against the libobs stand-in shim with
+ * a matrix of sources per switcher and switcher instances, and reports the
+ * per-instance cost of settings updates, ticks, renders, switches and the
+ * memory held by the switchers. */
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../source-switcher-core.h"
+#include "../source-switcher-watch.h"
+#include "../source-switcher-writer.h"
+
+#define FRAME_NS 16666667ULL
+#define TICK_FRAMES 600
+#define SWITCHES_PER_INSTANCE 200
+#define DEFAULT_MAX_ENTRIES 1000000
+
+struct bench_result {
+	size_t sources;
+	size_t instances;
+	double update_ns;
+	double resync_ns;
+	double edit_ns;
+	double tick_ns;
+	double render_ns;
+	double switch_ns;
+	double name_switch_ns;
+	double rename_ns;
+	double bytes_per_instance;
+};
+
+static uint64_t frame_time = 1000000000ULL;
+
+static void next_frame(void)
+{
+	frame_time += FRAME_NS;
+	shim_set_video_frame_time(frame_time);
+}
+
+static struct switcher_info *bench_switcher_create(size_t idx, bool transition)
+{
+	char name[64];
+	struct switcher_info *switcher = bzalloc(sizeof(struct switcher_info));
+	snprintf(name, sizeof(name), "switcher %zu", idx);
+	switcher_init(switcher, shim_private_source_create(name));
+	switcher->loop = true;
+	switcher->time_switch = true;
+	switcher->time_switch_duration = 250;
+	switcher->time_switch_to = SWITCH_NEXT;
+	switcher->transition_resize = true;
+	switcher->transition_duration = 100;
+	if (transition)
+		switcher->transition = shim_transition_create("transition");
+	return switcher;
+}
+
+static void bench_switcher_destroy(struct switcher_info *switcher)
+{
+	switcher_render_cache_free(switcher);
+	switcher_release(switcher);
+	obs_source_release(switcher->transition);
+	obs_source_release(switcher->source);
+	bfree(switcher);
+}
+
+static void run(struct bench_result *result, const char **names, size_t num_sources, size_t num_instances, bool transition)
+{
+	struct switcher_info **switchers = bzalloc(sizeof(struct switcher_info *) * num_instances);
+	result->sources = num_sources;
+	result->instances = num_instances;
+
+	const size_t mem_before = shim_bmem_allocated();
+	for (size_t i = 0; i < num_instances; i++)
+		switchers[i] = bench_switcher_create(i, transition);
+
+	uint64_t start = os_gettime_ns();
+	for (size_t i = 0; i < num_instances; i++)
+		switcher_update_sources(switchers[i], names, NULL, num_sources);
+	result->update_ns = (double)(os_gettime_ns() - start) / (double)num_instances;
+	result->bytes_per_instance = (double)(shim_bmem_allocated() - mem_before) / (double)num_instances;
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < num_instances; i++)
+		switcher_update_sources(switchers[i], names, NULL, num_sources);
+	result->resync_ns = (double)(os_gettime_ns() - start) / (double)num_instances;
+
+	/* replace one entry in the middle of the list with a source that is not listed yet */
+	const char **edited = bzalloc(sizeof(const char *) * num_sources);
+	memcpy(edited, names, sizeof(const char *) * num_sources);
+	edited[num_sources / 2] = names[num_sources];
+	start = os_gettime_ns();
+	for (size_t i = 0; i < num_instances; i++)
+		switcher_update_sources(switchers[i], edited, NULL, num_sources);
+	result->edit_ns = (double)(os_gettime_ns() - start) / (double)num_instances;
+	bfree((void *)edited);
+
+	uint64_t tick_total = 0;
+	uint64_t render_total = 0;
+	for (size_t f = 0; f < TICK_FRAMES; f++) {
+		next_frame();
+		start = os_gettime_ns();
+		for (size_t i = 0; i < num_instances; i++)
+			switcher_video_tick(switchers[i], (float)FRAME_NS / 1000000000.0f);
+		const uint64_t mid = os_gettime_ns();
+		for (size_t i = 0; i < num_instances; i++)
+			switcher_video_render(switchers[i], NULL);
+		render_total += os_gettime_ns() - mid;
+		tick_total += mid - start;
+	}
+	result->tick_ns = (double)tick_total / (double)(TICK_FRAMES * num_instances);
+	result->render_ns = (double)render_total / (double)(TICK_FRAMES * num_instances);
+
+	start = os_gettime_ns();
+	for (size_t s = 0; s < SWITCHES_PER_INSTANCE; s++) {
+		next_frame();
+		for (size_t i = 0; i < num_instances; i++)
+			switcher_switch_to(switchers[i], SWITCH_NEXT);
+	}
+	result->switch_ns = (double)(os_gettime_ns() - start) / (double)(SWITCHES_PER_INSTANCE * num_instances);
+
+	start = os_gettime_ns();
+	for (size_t s = 0; s < SWITCHES_PER_INSTANCE; s++) {
+		next_frame();
+		const char *name = names[(s * 7919) % num_sources];
+		for (size_t i = 0; i < num_instances; i++)
+			switcher_switch_to_name(switchers[i], name);
+	}
+	result->name_switch_ns = (double)(os_gettime_ns() - start) / (double)(SWITCHES_PER_INSTANCE * num_instances);
+
+	/* rename a listed source back and forth, reaching every instance through the registry and its command queue */
+	start = os_gettime_ns();
+	for (size_t s = 0; s < SWITCHES_PER_INSTANCE; s++) {
+		const char *name = names[(s * 7919) % num_sources];
+		switcher_registry_rename(name, "renamed", NULL);
+		switcher_registry_rename("renamed", name, NULL);
+		for (size_t i = 0; i < num_instances; i++)
+			switcher_commands_run(switchers[i]);
+	}
+	result->rename_ns = (double)(os_gettime_ns() - start) / (double)(SWITCHES_PER_INSTANCE * 2);
+
+	for (size_t i = 0; i < num_instances; i++)
+		bench_switcher_destroy(switchers[i]);
+	bfree(switchers);
+}
+
+/* Time from writing the current source file until a tick has switched to
+ * the written source, with the watcher thread delivering the change. When
+ * polled is set the directory only exists after the watch was added, so
+ * inotify can not watch it and the watcher falls back to polling. */
+static void run_file_watch(const char **names, size_t num_sources, bool polled)
+{
+	char dir[] = "/tmp/source-switcher-bench-XXXXXX";
+	if (!mkdtemp(dir))
+		return;
+	char path[sizeof(dir) + 16];
+	snprintf(path, sizeof(path), "%s/current.txt", dir);
+	if (polled)
+		rmdir(dir);
+
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher->current_source_file = true;
+	switcher->current_source_file_watch = true;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	switcher_watch_add(switcher, path);
+	if (polled)
+		mkdir(dir, 0700);
+
+	const size_t writes = 20;
+	uint64_t total = 0;
+	uint64_t worst = 0;
+	size_t switched = 0;
+	for (size_t w = 0; w < writes; w++) {
+		const size_t index = (w * 7 + 1) % num_sources;
+		os_sleep_ms(5);
+		const uint64_t start = os_gettime_ns();
+		os_quick_write_utf8_file(path, names[index], strlen(names[index]), false);
+		while (os_gettime_ns() - start < 1000000000ULL) {
+			switcher_video_tick(switcher, 0.0f);
+			if (switcher->current_index == index && switcher->current_source)
+				break;
+		}
+		const uint64_t elapsed = os_gettime_ns() - start;
+		if (switcher->current_index == index) {
+			switched++;
+			total += elapsed;
+			if (elapsed > worst)
+				worst = elapsed;
+		}
+	}
+	printf("file watch %-6s: %zu/%zu switched, avg %.1f us, worst %.1f us from write to switch\n",
+	       polled ? "polled" : "inotify", switched, writes, switched ? (double)total / (double)switched / 1000.0 : 0.0,
+	       (double)worst / 1000.0);
+
+	switcher_watch_remove(switcher);
+	bench_switcher_destroy(switcher);
+	unlink(path);
+	rmdir(dir);
+}
+
+/* A day of timed switches at 60 fps with a slot length that is not a whole
+ * number of frames, every 10000th frame is dropped. Reports how far the
+ * last switch is from where the schedule says it should be. */
+static void run_schedule(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch_duration = 1001;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	const uint64_t slot = switcher->time_switch_duration * 1000000ULL;
+	const uint64_t frames = 24ULL * 3600ULL * 60ULL;
+
+	next_frame();
+	switcher_switch_to(switcher, SWITCH_FIRST);
+	const uint64_t epoch = frame_time;
+	uint64_t last_switch = epoch;
+	size_t switches = 0;
+	const uint64_t start = os_gettime_ns();
+	for (uint64_t f = 0; f < frames; f++) {
+		next_frame();
+		if (f % 10000 == 9999)
+			next_frame();
+		const size_t index = switcher->current_index;
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		if (switcher->current_index != index) {
+			switches++;
+			last_switch = frame_time;
+		}
+	}
+	const double elapsed = (double)(os_gettime_ns() - start);
+	const double drift = ((double)last_switch - (double)(epoch + switches * slot)) / 1000000.0;
+	printf("schedule 24h: %zu switches, last switch %.2f ms after its deadline, %llu late, max %.2f ms, %.1f ns per tick\n",
+	       switches, drift, (unsigned long long)switcher->time_switch_slips,
+	       (double)switcher->time_switch_max_slip / 1000000.0, elapsed / (double)frames);
+	bench_switcher_destroy(switcher);
+}
+
+/* Seeking with the media time slider through a list where every entry has
+ * its own duration. */
+static void run_seek(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	struct switcher_entry *entries = bzalloc(sizeof(struct switcher_entry) * num_sources);
+	for (size_t i = 0; i < num_sources; i++) {
+		entries[i].duration = 500 + (i * 7919) % 10000;
+		entries[i].weight = 1.0;
+	}
+	switcher_update_sources(switcher, names, entries, num_sources);
+	const int64_t total = switcher_get_duration(switcher);
+
+	const size_t seeks = 10000;
+	size_t wrong = 0;
+	const uint64_t start = os_gettime_ns();
+	for (size_t s = 0; s < seeks; s++) {
+		const int64_t position = (int64_t)(((uint64_t)s * 2654435761ULL) % (uint64_t)total);
+		switcher_set_time(switcher, position);
+		if (switcher_get_time(switcher) != position)
+			wrong++;
+	}
+	const double elapsed = (double)(os_gettime_ns() - start);
+	printf("seek %zu entries: %.1f ns per seek, %zu of %zu positions read back differently\n", num_sources,
+	       elapsed / (double)seeks, wrong, seeks);
+	bfree(entries);
+	bench_switcher_destroy(switcher);
+}
+
+/* Shuffle hotkey on a long list, whether a bag ever repeats a source, and
+ * whether next and previous after the hotkey walk the shuffled order. */
+static void run_shuffle(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+
+	const size_t shuffles = 100;
+	const uint64_t start = os_gettime_ns();
+	for (size_t s = 0; s < shuffles; s++)
+		switcher_shuffle(switcher);
+	const double elapsed = (double)(os_gettime_ns() - start);
+
+	size_t repeats = 0;
+	bool *seen = bzalloc(sizeof(bool) * num_sources);
+	size_t shown = 1;
+	seen[switcher->current_index] = true;
+	size_t previous = switcher->current_index;
+	for (size_t s = 0; s < num_sources * 3; s++) {
+		switcher_switch_to(switcher, SWITCH_SHUFFLE);
+		if (switcher->current_index == previous || seen[switcher->current_index])
+			repeats++;
+		seen[switcher->current_index] = true;
+		previous = switcher->current_index;
+		if (++shown == num_sources) {
+			memset(seen, 0, sizeof(bool) * num_sources);
+			shown = 0;
+		}
+	}
+	bfree(seen);
+
+	switcher_shuffle(switcher);
+	size_t *order = bmalloc(sizeof(size_t) * num_sources);
+	memcpy(order, switcher->shuffle_bag.array, sizeof(size_t) * num_sources);
+	size_t unordered = 0;
+	for (size_t s = 1; s <= num_sources; s++) {
+		switcher_switch_to(switcher, SWITCH_NEXT);
+		if (switcher->current_index != order[s % num_sources])
+			unordered++;
+	}
+	for (size_t s = num_sources; s > 0; s--) {
+		switcher_switch_to(switcher, SWITCH_PREVIOUS);
+		if (switcher->current_index != order[s - 1])
+			unordered++;
+	}
+	bfree(order);
+	printf("shuffle %zu entries: %.1f us per shuffle, %zu repeats in %zu switches, %zu of %zu next and previous "
+	       "off the shuffled order\n",
+	       num_sources, elapsed / (double)shuffles / 1000.0, repeats, num_sources * 3, unordered, num_sources * 2);
+	bench_switcher_destroy(switcher);
+}
+
+/* Random switches where the first entry weighs as much as all others
+ * together. Random never repeats the current entry, so it should come up
+ * on about a third of the switches. */
+static void run_weighted(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher_random_seed(switcher, 42);
+	struct switcher_entry *entries = bzalloc(sizeof(struct switcher_entry) * num_sources);
+	for (size_t i = 0; i < num_sources; i++)
+		entries[i].weight = i ? 1.0 : (double)(num_sources - 1);
+	switcher_update_sources(switcher, names, entries, num_sources);
+
+	const size_t switches = 100000;
+	size_t first = 0;
+	const uint64_t start = os_gettime_ns();
+	for (size_t s = 0; s < switches; s++) {
+		switcher_switch_to(switcher, SWITCH_RANDOM);
+		if (switcher->current_index == 0)
+			first++;
+	}
+	const double elapsed = (double)(os_gettime_ns() - start);
+	printf("weighted random %zu entries: %.1f ns per switch, first entry shown %.1f%% of switches\n", num_sources,
+	       elapsed / (double)switches, 100.0 * (double)first / (double)switches);
+	bfree(entries);
+	bench_switcher_destroy(switcher);
+}
+
+/* Reference counting done per frame while a resizing transition runs, with
+ * the frame ticked, rendered and its size queried like libobs does. */
+static void run_transition_geometry(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, true);
+	switcher->time_switch = false;
+	switcher->transition_duration = 1000;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	next_frame();
+	switcher_switch_to(switcher, SWITCH_NEXT);
+
+	size_t frames = 0;
+	const size_t refs = shim_ref_calls();
+	const uint64_t start = os_gettime_ns();
+	while (frames < 30 && switcher_transition_active(switcher->current_transition)) {
+		next_frame();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		switcher_video_render(switcher, NULL);
+		switcher_get_width(switcher);
+		switcher_get_height(switcher);
+		frames++;
+	}
+	const double elapsed = (double)(os_gettime_ns() - start);
+	printf("transition geometry: %.1f refs and %.1f ns per frame over %zu frames\n",
+	       (double)(shim_ref_calls() - refs) / (double)frames, elapsed / (double)frames, frames);
+	bench_switcher_destroy(switcher);
+}
+
+/* Child renders with the render cache on for a static image source that changes
+ * its settings once a second, for the same source showing a gif or a text
+ * source reading from a file, which are never cached, and for an image whose
+ * file is replaced halfway, which is drawn directly until it reloaded. */
+static void run_render_cache(const char **names, size_t num_sources)
+{
+	static const char *modes[] = {"off", "on", "gif", "text file", "image file"};
+	char path[] = "/tmp/source-switcher-bench-XXXXXX";
+	const int fd = mkstemp(path);
+	if (fd == -1)
+		return;
+	close(fd);
+	for (int mode = 0; mode < 5; mode++) {
+		struct switcher_info *switcher = bench_switcher_create(0, false);
+		switcher->time_switch = false;
+		switcher->render_cache = mode > 0;
+		switcher_update_sources(switcher, names, NULL, num_sources);
+		obs_source_t *source = switcher->current_source;
+		shim_source_set_id(source, mode == 3 ? "text_ft2_source" : "image_source");
+		shim_source_set_file(source, mode == 2 ? "/tmp/animated.GIF" : mode == 4 ? path : "/tmp/still.png");
+		shim_source_set_from_file(source, mode == 3);
+		const size_t renders = shim_source_render_count(source);
+		const size_t draws = shim_texture_draws();
+		for (size_t f = 0; f < TICK_FRAMES; f++) {
+			next_frame();
+			if (mode != 4 && f % 60 == 59)
+				shim_source_update(source);
+			if (mode == 4 && f == TICK_FRAMES / 2) {
+				struct timespec times[2] = {{0, UTIME_OMIT}, {time(NULL) + 10, 0}};
+				utimensat(AT_FDCWD, path, times, 0);
+			}
+			switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+			switcher_video_render(switcher, NULL);
+		}
+		printf("render cache %-10s: %zu child renders, %zu texture draws in %d frames, %llu hits, %llu misses\n",
+		       modes[mode], shim_source_render_count(source) - renders, shim_texture_draws() - draws, TICK_FRAMES,
+		       (unsigned long long)switcher->render_cache_hits, (unsigned long long)switcher->render_cache_misses);
+		shim_source_set_id(source, NULL);
+		shim_source_set_file(source, NULL);
+		shim_source_set_from_file(source, false);
+		bench_switcher_destroy(switcher);
+	}
+	unlink(path);
+}
+
+/* Frames a transition stays an active child after it has finished, for a
+ * switch to the next source and a hide transition to none. */
+static void run_transition_end(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, true);
+	switcher->time_switch = false;
+	switcher->hide_transition = shim_transition_create("hide transition");
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	next_frame();
+
+	for (int hide = 0; hide < 2; hide++) {
+		obs_source_t *transition = hide ? switcher->hide_transition : switcher->transition;
+		switcher_switch_to(switcher, hide ? SWITCH_NONE : SWITCH_NEXT);
+		size_t frames = 0;
+		size_t lingering = 0;
+		for (; frames < 30; frames++) {
+			const bool finished = obs_transition_get_time(transition) >= 1.0f;
+			next_frame();
+			switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+			switcher_video_render(switcher, NULL);
+			if (finished && obs_source_active(transition))
+				lingering++;
+		}
+		printf("transition end %s: active for %zu frames after it finished\n", hide ? "hide  " : "normal", lingering);
+	}
+	obs_source_release(switcher->hide_transition);
+	switcher->hide_transition = NULL;
+	bench_switcher_destroy(switcher);
+}
+
+#define QUEUE_PRODUCERS 4
+#define QUEUE_POSTS 2000
+
+struct bench_producer {
+	pthread_t thread;
+	struct switcher_info *switcher;
+	volatile long posted;
+	volatile long dropped;
+	uint64_t post_ns;
+};
+
+static volatile long bench_commands_run = 0;
+
+static void bench_switch_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	switcher->switch_origin = command->origin;
+	switcher_switch_to(switcher, command->switch_to);
+	os_atomic_inc_long(&bench_commands_run);
+}
+
+static void *bench_producer_thread(void *data)
+{
+	struct bench_producer *producer = data;
+	for (size_t i = 0; i < QUEUE_POSTS; i++) {
+		struct switcher_command command = {
+			.proc = bench_switch_command,
+			/* like renames, these wait in the overflow list when the queue is full */
+			.keep = i % 4 == 0,
+			.origin = SWITCHER_ORIGIN_HOTKEY,
+			.switch_to = SWITCH_NEXT,
+		};
+		const uint64_t start = os_gettime_ns();
+		if (switcher_post_command(producer->switcher, &command))
+			os_atomic_inc_long(&producer->posted);
+		else
+			os_atomic_inc_long(&producer->dropped);
+		producer->post_ns += os_gettime_ns() - start;
+		if (i % 8 == 7)
+			os_sleep_ms(1);
+	}
+	return NULL;
+}
+
+/* Threads posting switches like hotkeys and proc calls do while the main
+ * thread ticks and renders, every posted command has to run exactly once
+ * and only commands not marked keep may be dropped. */
+static void run_command_queue(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, true);
+	switcher->time_switch = false;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	os_atomic_set_long(&bench_commands_run, 0);
+
+	struct bench_producer producers[QUEUE_PRODUCERS] = {0};
+	for (size_t i = 0; i < QUEUE_PRODUCERS; i++) {
+		producers[i].switcher = switcher;
+		pthread_create(&producers[i].thread, NULL, bench_producer_thread, &producers[i]);
+	}
+	size_t frames = 0;
+	uint64_t tick_ns = 0;
+	for (;;) {
+		bool done = true;
+		long posted = 0;
+		for (size_t i = 0; i < QUEUE_PRODUCERS; i++) {
+			posted += os_atomic_load_long(&producers[i].posted);
+			done = done && os_atomic_load_long(&producers[i].posted) + os_atomic_load_long(&producers[i].dropped) ==
+					       QUEUE_POSTS;
+		}
+		/* done once the ticks ran what was left in the queue and the overflow list */
+		done = done && os_atomic_load_long(&bench_commands_run) == posted;
+		next_frame();
+		const uint64_t start = os_gettime_ns();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		tick_ns += os_gettime_ns() - start;
+		switcher_video_render(switcher, NULL);
+		frames++;
+		if (done)
+			break;
+		os_sleep_ms(1);
+	}
+	long posted = 0;
+	long dropped = 0;
+	uint64_t post_ns = 0;
+	for (size_t i = 0; i < QUEUE_PRODUCERS; i++) {
+		pthread_join(producers[i].thread, NULL);
+		posted += producers[i].posted;
+		dropped += producers[i].dropped;
+		post_ns += producers[i].post_ns;
+	}
+	printf("command queue %d threads: %ld posted, %ld run, %ld dropped, %.1f ns per post, %.1f us per tick over %zu "
+	       "frames\n",
+	       QUEUE_PRODUCERS, posted, os_atomic_load_long(&bench_commands_run), dropped,
+	       (double)post_ns / (double)(posted + dropped), (double)tick_ns / (double)frames / 1000.0, frames);
+	bench_switcher_destroy(switcher);
+}
+
+struct bench_signal_count {
+	size_t started;
+	size_t completed;
+	size_t transition_ended;
+	long long last_to_index;
+	long long last_started;
+};
+
+static void bench_switch_started(void *data, calldata_t *cd)
+{
+	struct bench_signal_count *count = data;
+	count->started++;
+	count->last_to_index = calldata_int(cd, "to_index");
+	count->last_started = calldata_int(cd, "started");
+}
+
+static void bench_switch_completed(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	((struct bench_signal_count *)data)->completed++;
+}
+
+static void bench_transition_ended(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	((struct bench_signal_count *)data)->transition_ended++;
+}
+
+/* Switch signals seen by a listener over a run of timed switches with a
+ * transition and a final switch to none. */
+static void run_signals(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, true);
+	struct bench_signal_count count = {0};
+	signal_handler_t *sh = obs_source_get_signal_handler(switcher->source);
+	signal_handler_connect(sh, "switch_started", bench_switch_started, &count);
+	signal_handler_connect(sh, "switch_completed", bench_switch_completed, &count);
+	signal_handler_connect(sh, "transition_ended", bench_transition_ended, &count);
+	switcher_update_sources(switcher, names, NULL, num_sources);
+
+	for (size_t f = 0; f < TICK_FRAMES; f++) {
+		next_frame();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		switcher_video_render(switcher, NULL);
+	}
+	switcher->time_switch = false;
+	switcher_switch_to(switcher, SWITCH_NONE);
+	for (size_t f = 0; f < 30; f++) {
+		next_frame();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		switcher_video_render(switcher, NULL);
+	}
+	printf("signals: %zu started, %zu completed, %zu transitions ended, last to index %lld\n", count.started,
+	       count.completed, count.transition_ended, count.last_to_index);
+	signal_handler_disconnect(sh, "switch_started", bench_switch_started, &count);
+	signal_handler_disconnect(sh, "switch_completed", bench_switch_completed, &count);
+	signal_handler_disconnect(sh, "transition_ended", bench_transition_ended, &count);
+	bench_switcher_destroy(switcher);
+}
+
+/* Hotkey presses that wait in the queue for the next tick, the reported switch
+ * has to start when the press was posted and not when the tick ran it. */
+static void run_queue_latency(const char **names, size_t num_sources)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	struct bench_signal_count count = {0};
+	switcher->time_switch = false;
+	signal_handler_t *sh = obs_source_get_signal_handler(switcher->source);
+	signal_handler_connect(sh, "switch_started", bench_switch_started, &count);
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	const size_t presses = 20;
+	uint64_t post_to_start = 0;
+	uint64_t start_to_tick = 0;
+	for (size_t p = 0; p < presses; p++) {
+		struct switcher_command command = {
+			.proc = switcher_switch_command,
+			.origin = SWITCHER_ORIGIN_HOTKEY,
+			.switch_to = SWITCH_NEXT,
+			.index = -1,
+		};
+		const uint64_t before = os_gettime_ns();
+		switcher_post_command(switcher, &command);
+		os_sleep_ms(2);
+		next_frame();
+		const uint64_t tick = os_gettime_ns();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		post_to_start += (uint64_t)count.last_started - before;
+		start_to_tick += tick - (uint64_t)count.last_started;
+	}
+	printf("queued switches: %zu started, timed from %.1f us after the post, %.1f us of queue wait included\n",
+	       count.started, (double)post_to_start / (double)presses / 1000.0,
+	       (double)start_to_tick / (double)presses / 1000.0);
+	signal_handler_disconnect(sh, "switch_started", bench_switch_started, &count);
+	bench_switcher_destroy(switcher);
+}
+
+/* Next pressed several times within every frame, with and without collapsing
+ * the requests of a frame into one switch. */
+static void run_coalesce(const char **names, size_t num_sources)
+{
+	for (int coalesce = 0; coalesce < 2; coalesce++) {
+		struct switcher_info *switcher = bench_switcher_create(0, true);
+		struct bench_signal_count count = {0};
+		switcher->time_switch = false;
+		signal_handler_t *sh = obs_source_get_signal_handler(switcher->source);
+		signal_handler_connect(sh, "switch_started", bench_switch_started, &count);
+		switcher_update_sources(switcher, names, NULL, num_sources);
+		next_frame();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		count.started = 0;
+
+		const size_t frames = 60;
+		const size_t presses = 5;
+		uint64_t tick_ns = 0;
+		for (size_t f = 0; f < frames; f++) {
+			for (size_t p = 0; p < presses; p++) {
+				struct switcher_command command = {
+					.proc = switcher_switch_command,
+					.coalesce = coalesce,
+					.origin = SWITCHER_ORIGIN_HOTKEY,
+					.switch_to = SWITCH_NEXT,
+					.index = -1,
+				};
+				switcher_post_command(switcher, &command);
+			}
+			next_frame();
+			const uint64_t start = os_gettime_ns();
+			switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+			tick_ns += os_gettime_ns() - start;
+			switcher_video_render(switcher, NULL);
+		}
+		printf("coalesce %s: %zu presses, %zu switches, %llu collapsed, index %zu, %.1f us per tick\n",
+		       coalesce ? "on " : "off", frames * presses, count.started,
+		       (unsigned long long)switcher->switches_coalesced, switcher->current_index,
+		       (double)tick_ns / (double)frames / 1000.0);
+		signal_handler_disconnect(sh, "switch_started", bench_switch_started, &count);
+		bench_switcher_destroy(switcher);
+	}
+}
+
+/* A random pick followed by first or last within one frame has to end up
+ * on the first or last entry, the later absolute switch wins. */
+static void run_coalesce_random(const char **names, size_t num_sources, int32_t switch_to)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	const size_t expected = switch_to == SWITCH_FIRST ? 0 : num_sources - 1;
+	const size_t frames = 100;
+	size_t wrong = 0;
+	for (size_t f = 0; f < frames; f++) {
+		const int32_t presses[] = {SWITCH_RANDOM, switch_to};
+		for (size_t p = 0; p < 2; p++) {
+			struct switcher_command command = {
+				.proc = switcher_switch_command,
+				.coalesce = true,
+				.origin = SWITCHER_ORIGIN_HOTKEY,
+				.switch_to = presses[p],
+				.index = -1,
+			};
+			switcher_post_command(switcher, &command);
+		}
+		next_frame();
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		if (switcher->current_index != expected)
+			wrong++;
+	}
+	printf("coalesce random then %-5s: %zu of %zu frames not on index %zu\n",
+	       switch_to == SWITCH_FIRST ? "first" : "last", wrong, frames, expected);
+	bench_switcher_destroy(switcher);
+}
+
+/* Hotkeys registered by a first settings update with and without a limit,
+ * and the cost of a source hotkey press until its switch is done. */
+static void run_hotkeys(const char **names, size_t num_sources)
+{
+	for (int limited = 0; limited < 2; limited++) {
+		struct switcher_info *switcher = bench_switcher_create(0, false);
+		switcher->time_switch = false;
+		switcher->hotkey_limit = limited ? 10 : 0;
+		struct switcher_entry *entries = bzalloc(sizeof(struct switcher_entry) * num_sources);
+		for (size_t i = 0; i < num_sources; i++) {
+			entries[i].weight = 1.0;
+			/* a few entries further down are marked to keep their hotkey */
+			entries[i].hotkey = i % 100 == 99;
+		}
+		uint64_t start = os_gettime_ns();
+		switcher_update_sources(switcher, names, entries, num_sources);
+		const double update_ns = (double)(os_gettime_ns() - start);
+
+		const size_t presses = 10000;
+		start = os_gettime_ns();
+		for (size_t p = 0; p < presses; p++) {
+			const obs_hotkey_id id = switcher->hotkeys.array[(p * 7919) % switcher->hotkeys.num].hotkey_id;
+			switcher_switch_source_hotkey(switcher, id, NULL, true);
+			switcher_commands_run(switcher);
+		}
+		const double press_ns = (double)(os_gettime_ns() - start) / (double)presses;
+		printf("hotkeys %zu entries, limit %zu: %zu registered, %.1f us first update, %.1f ns per press\n", num_sources,
+		       switcher->hotkey_limit, switcher->hotkeys.num, update_ns / 1000.0, press_ns);
+		bfree(entries);
+		bench_switcher_destroy(switcher);
+	}
+}
+
+/* Average time from a switch until the new source has frames, with sources
+ * that need some time after activation before they show anything. When flip
+ * is set the switcher goes back and forth between two sources. */
+static double bench_time_to_frames(struct switcher_info *switcher, bool flip, size_t *switches)
+{
+	shim_set_source_warmup(200000000ULL);
+	obs_source_t *shown = switcher->current_source;
+	uint64_t switch_time = 0;
+	bool waiting = false;
+	uint64_t total = 0;
+	*switches = 0;
+	for (size_t f = 0; f < TICK_FRAMES * 4; f++) {
+		next_frame();
+		if (flip && f % 15 == 0)
+			switcher_switch_to(switcher, (f / 15) % 2 ? SWITCH_PREVIOUS : SWITCH_NEXT);
+		switcher_video_tick(switcher, (float)FRAME_NS / 1000000000.0f);
+		if (switcher->current_source != shown) {
+			shown = switcher->current_source;
+			switch_time = frame_time;
+			waiting = true;
+		}
+		if (waiting && shim_source_ready(shown)) {
+			waiting = false;
+			(*switches)++;
+			total += frame_time - switch_time;
+		}
+	}
+	shim_set_source_warmup(0);
+	return *switches ? (double)total / (double)*switches / 1000000.0 : 0.0;
+}
+
+static void run_lookahead(const char **names, size_t num_sources, int32_t switch_to, size_t lookahead)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch_to = switch_to;
+	switcher->lookahead = lookahead;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	size_t switches;
+	const double avg = bench_time_to_frames(switcher, false, &switches);
+	printf("lookahead %zu %-6s: %zu switches, avg %.1f ms until the new source has frames\n", lookahead,
+	       switch_to == SWITCH_RANDOM ? "random" : "next", switches, avg);
+	bench_switcher_destroy(switcher);
+}
+
+static void run_warm_pool(const char **names, size_t num_sources, size_t pool_size)
+{
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher->warm_pool_size = pool_size;
+	switcher_update_sources(switcher, names, NULL, num_sources);
+	size_t switches;
+	const double avg = bench_time_to_frames(switcher, true, &switches);
+	printf("warm pool %zu  flip  : %zu switches, avg %.1f ms until the new source has frames\n", pool_size, switches,
+	       avg);
+	bench_switcher_destroy(switcher);
+}
+
+/* Cost of a switch with the current source file enabled, and how many of
+ * the queued file writes were collapsed while the writer thread was busy. */
+static void run_file_write(const char **names, size_t num_sources)
+{
+	char path[] = "/tmp/source-switcher-bench-XXXXXX";
+	const int fd = mkstemp(path);
+	if (fd == -1)
+		return;
+	close(fd);
+
+	struct switcher_info *switcher = bench_switcher_create(0, false);
+	switcher->time_switch = false;
+	switcher->current_source_file = true;
+	switcher->current_source_file_path = bstrdup(path);
+	switcher_update_sources(switcher, names, NULL, num_sources);
+
+	const long written = switcher_writer_written();
+	const long coalesced = switcher_writer_coalesced();
+	const size_t switches = 10000;
+	const uint64_t start = os_gettime_ns();
+	for (size_t s = 0; s < switches; s++)
+		switcher_switch_to(switcher, SWITCH_NEXT);
+	const uint64_t elapsed = os_gettime_ns() - start;
+	/* wait for the writer to catch up with the last switch */
+	const char *last_name = obs_source_get_name(switcher->current_source);
+	for (int tries = 0; tries < 1000; tries++) {
+		char *content = os_quick_read_utf8_file(path);
+		const bool done = content && strcmp(content, last_name) == 0;
+		bfree(content);
+		if (done)
+			break;
+		os_sleep_ms(1);
+	}
+	printf("file write: %.1f ns per switch, %ld of %zu writes coalesced\n", (double)elapsed / (double)switches,
+	       switcher_writer_coalesced() - coalesced, (size_t)(switcher_writer_written() - written) +
+	       (size_t)(switcher_writer_coalesced() - coalesced));
+
+	bfree(switcher->current_source_file_path);
+	switcher->current_source_file_path = NULL;
+	bench_switcher_destroy(switcher);
+	unlink(path);
+}
+
+static size_t parse_list(const char *arg, size_t *values, size_t max)
+{
+	size_t count = 0;
+	while (*arg && count < max) {
+		char *end;
+		const unsigned long long v = strtoull(arg, &end, 10);
+		if (end == arg)
+			break;
+		values[count++] = (size_t)v;
+		arg = *end == ',' ? end + 1 : end;
+	}
+	return count;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s sources,...] [-i instances,...] [--max-entries n] [--no-transition]\n"
+		"  defaults: -s 10,1000,10000 -i 1,10,100,1000 --max-entries %d\n"
+		"  combinations with more than max-entries sources in total are skipped\n",
+		name, DEFAULT_MAX_ENTRIES);
+}
+
+int main(int argc, char **argv)
+{
+	size_t source_counts[16] = {10, 1000, 10000};
+	size_t num_source_counts = 3;
+	size_t instance_counts[16] = {1, 10, 100, 1000};
+	size_t num_instance_counts = 4;
+	size_t max_entries = DEFAULT_MAX_ENTRIES;
+	bool transition = true;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			num_source_counts = parse_list(argv[++i], source_counts, 16);
+		} else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			num_instance_counts = parse_list(argv[++i], instance_counts, 16);
+		} else if (strcmp(argv[i], "--max-entries") == 0 && i + 1 < argc) {
+			max_entries = (size_t)strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--no-transition") == 0) {
+			transition = false;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	size_t max_sources = 0;
+	for (size_t i = 0; i < num_source_counts; i++) {
+		if (source_counts[i] > max_sources)
+			max_sources = source_counts[i];
+	}
+
+	/* one spare source to swap into the lists when measuring edits */
+	const char **names = bzalloc(sizeof(const char *) * (max_sources + 1));
+	for (size_t i = 0; i <= max_sources; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "source %zu", i);
+		obs_source_t *source = shim_source_create(name, 1280 + (uint32_t)(i % 3) * 320, 720 + (uint32_t)(i % 3) * 180);
+		names[i] = obs_source_get_name(source);
+		obs_source_release(source);
+	}
+	shim_set_video_frame_time(frame_time);
+	switcher_registry_init();
+	switcher_watch_init();
+	switcher_writer_init();
+
+	printf("%8s %9s %14s %14s %14s %10s %10s %10s %10s %12s %14s\n", "sources", "instances", "update ns", "resync ns",
+	       "edit ns", "tick ns", "render ns", "switch ns", "name ns", "rename ns", "bytes/inst");
+	for (size_t s = 0; s < num_source_counts; s++) {
+		for (size_t i = 0; i < num_instance_counts; i++) {
+			if (source_counts[s] * instance_counts[i] > max_entries) {
+				printf("%8zu %9zu %14s\n", source_counts[s], instance_counts[i], "skipped");
+				continue;
+			}
+			struct bench_result r;
+			run(&r, names, source_counts[s], instance_counts[i], transition);
+			printf("%8zu %9zu %14.0f %14.0f %14.0f %10.1f %10.1f %10.1f %10.1f %12.0f %14.0f\n", r.sources,
+			       r.instances, r.update_ns, r.resync_ns, r.edit_ns, r.tick_ns, r.render_ns, r.switch_ns,
+			       r.name_switch_ns, r.rename_ns, r.bytes_per_instance);
+			fflush(stdout);
+		}
+	}
+
+	if (max_sources > 1) {
+		for (size_t lookahead = 0; lookahead <= 2; lookahead++) {
+			run_lookahead(names, max_sources, SWITCH_NEXT, lookahead);
+			run_lookahead(names, max_sources, SWITCH_RANDOM, lookahead);
+		}
+		run_warm_pool(names, max_sources, 0);
+		run_warm_pool(names, max_sources, 2);
+		run_schedule(names, max_sources);
+		run_seek(names, max_sources);
+		run_shuffle(names, max_sources);
+		run_weighted(names, max_sources);
+		run_transition_geometry(names, max_sources);
+		run_transition_end(names, max_sources);
+		run_render_cache(names, max_sources);
+		run_signals(names, max_sources);
+		run_command_queue(names, max_sources);
+		run_queue_latency(names, max_sources);
+		run_coalesce(names, max_sources);
+		run_coalesce_random(names, max_sources, SWITCH_FIRST);
+		run_coalesce_random(names, max_sources, SWITCH_LAST);
+		run_hotkeys(names, max_sources);
+		run_file_watch(names, max_sources, false);
+		run_file_watch(names, max_sources, true);
+		run_file_write(names, max_sources);
+	}
+
+	bfree((void *)names);
+	switcher_watch_free();
+	switcher_writer_free();
+	switcher_registry_free();
+	shim_shutdown();
+	if (bnum_allocs())
+		fprintf(stderr, "warning: %ld allocations leaked\n", bnum_allocs());
+	return 0;
+}
@@ -0,0 +1,1971 @@
+#include "source-switcher-core.h"
+#include "source-switcher-writer.h"
+#include <graphics/vec4.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <sys/stat.h>
+
+struct switcher_registry_entry {
+	DARRAY(struct switcher_info *) switchers;
+};
+
+static pthread_mutex_t registry_mutex;
+static struct switcher_map registry;
+
+static const char *switcher_signals[] = {
+	"void switch_started(ptr source, int from_index, string from_name, int to_index, string to_name, string trigger, "
+	"int started, int timestamp)",
+	"void switch_completed(ptr source, int from_index, string from_name, int to_index, string to_name, string trigger, "
+	"int started, int timestamp)",
+	"void transition_ended(ptr source, int from_index, string from_name, int to_index, string to_name, string trigger, "
+	"int started, int timestamp)",
+	NULL,
+};
+
+void switcher_init(struct switcher_info *switcher, obs_source_t *source)
+{
+	switcher->source = source;
+	switcher->state = OBS_MEDIA_STATE_PLAYING;
+	da_init(switcher->sources);
+	da_init(switcher->hotkeys);
+	da_init(switcher->preloaded);
+	da_init(switcher->random_picks);
+	da_init(switcher->shuffle_bag);
+	da_init(switcher->alias_table);
+	switcher->alias_dirty = true;
+	switcher_random_seed(switcher, 0);
+	da_init(switcher->warm_pool);
+	da_init(switcher->entries);
+	da_init(switcher->timeline);
+	switcher->timeline_dirty = true;
+	pthread_mutex_init(&switcher->timeline_mutex, NULL);
+	switcher_map_init(&switcher->source_indexes, false);
+	switcher_map_init(&switcher->name_indexes, true);
+	switcher_map_init(&switcher->hotkey_sources, false);
+	switcher_map_init(&switcher->source_hotkeys, false);
+	pthread_mutex_init(&switcher->source_file_mutex, NULL);
+	pthread_mutex_init(&switcher->latency_mutex, NULL);
+	pthread_mutex_init(&switcher->audio_fade_mutex, NULL);
+	pthread_mutex_init(&switcher->children_mutex, NULL);
+	pthread_mutex_init(&switcher->state_mutex, NULL);
+	switcher_command_queue_init(&switcher->commands);
+	signal_handler_add_array(obs_source_get_signal_handler(source), switcher_signals);
+	switcher_profile_names_update(switcher);
+}
+
+void switcher_profile_names_update(struct switcher_info *switcher)
+{
+	const char *name = obs_source_get_name(switcher->source);
+	if (!name)
+		name = "";
+	if (switcher->profile_source_name && strcmp(switcher->profile_source_name, name) == 0)
+		return;
+	bfree(switcher->profile_source_name);
+	switcher->profile_source_name = bstrdup(name);
+	profiler_name_store_t *store = obs_get_profiler_name_store();
+	switcher->profile_render = profile_store_name(store, "source_switcher_render(%s)", name);
+	switcher->profile_tick = profile_store_name(store, "source_switcher_tick(%s)", name);
+	switcher->profile_audio = profile_store_name(store, "source_switcher_audio(%s)", name);
+}
+
+/* rough size of what a source keeps around while active: one BGRA frame */
+static uint64_t switcher_source_estimate(obs_source_t *source)
+{
+	return (uint64_t)obs_source_get_width(source) * obs_source_get_height(source) * 4;
+}
+
+static void switcher_warm_pool_evict(struct switcher_info *switcher, size_t idx)
+{
+	obs_source_t *source = switcher->warm_pool.array[idx];
+	pthread_mutex_lock(&switcher->children_mutex);
+	da_erase(switcher->warm_pool, idx);
+	pthread_mutex_unlock(&switcher->children_mutex);
+	obs_source_remove_active_child(switcher->source, source);
+	obs_source_release(source);
+}
+
+void switcher_warm_pool_trim(struct switcher_info *switcher)
+{
+	uint64_t total = 0;
+	size_t keep = 0;
+	for (size_t i = 0; i < switcher->warm_pool.num;) {
+		obs_source_t *source = switcher->warm_pool.array[i];
+		/* sources dropped from the list or from obs leave the pool right away */
+		if (obs_source_removed(source) || !switcher_map_get(&switcher->source_indexes, source, NULL)) {
+			switcher_warm_pool_evict(switcher, i);
+			continue;
+		}
+		const uint64_t size = switcher_source_estimate(source);
+		if (keep >= switcher->warm_pool_size || (switcher->warm_pool_budget && total + size > switcher->warm_pool_budget)) {
+			switcher_warm_pool_evict(switcher, i);
+			continue;
+		}
+		total += size;
+		keep++;
+		i++;
+	}
+}
+
+/* the source that is no longer shown stays active, most recent first */
+static void switcher_warm_pool_push(struct switcher_info *switcher, obs_source_t *source)
+{
+	if (!switcher->warm_pool_size || !source)
+		return;
+	const size_t idx = da_find(switcher->warm_pool, &source, 0);
+	if (idx == 0)
+		return;
+	if (idx == DARRAY_INVALID) {
+		obs_source_add_active_child(switcher->source, source);
+		source = obs_source_get_ref(source);
+	}
+	pthread_mutex_lock(&switcher->children_mutex);
+	if (idx != DARRAY_INVALID)
+		da_erase(switcher->warm_pool, idx);
+	da_insert(switcher->warm_pool, 0, &source);
+	pthread_mutex_unlock(&switcher->children_mutex);
+	switcher_warm_pool_trim(switcher);
+}
+
+static bool switcher_warm_pool_take(struct switcher_info *switcher, obs_source_t *source)
+{
+	const size_t idx = da_find(switcher->warm_pool, &source, 0);
+	if (idx == DARRAY_INVALID)
+		return false;
+	switcher_warm_pool_evict(switcher, idx);
+	return true;
+}
+
+/* a media source that stayed active while it was not shown has been playing on its own, start it over */
+static void switcher_media_rewind(obs_source_t *source)
+{
+	if (obs_source_get_output_flags(source) & OBS_SOURCE_CONTROLLABLE_MEDIA)
+		obs_source_media_restart(source);
+}
+
+static long long switcher_signal_index(struct switcher_info *switcher, obs_source_t *source)
+{
+	size_t index;
+	if (!source || !switcher_map_get(&switcher->source_indexes, source, &index))
+		return -1;
+	return (long long)index;
+}
+
+/* call with latency_mutex held, timestamps are os_gettime_ns */
+static void switcher_signal_params(struct switcher_info *switcher, calldata_t *cd, uint64_t now)
+{
+	calldata_set_ptr(cd, "source", switcher->source);
+	calldata_set_int(cd, "from_index", switcher->signal_from_index);
+	calldata_set_string(cd, "from_name", switcher->signal_from_name ? switcher->signal_from_name : "");
+	calldata_set_int(cd, "to_index", switcher->signal_to_index);
+	calldata_set_string(cd, "to_name", switcher->signal_to_name ? switcher->signal_to_name : "");
+	calldata_set_string(cd, "trigger", switcher_origin_name(switcher->last_origin));
+	calldata_set_int(cd, "started", (long long)switcher->switch_start);
+	calldata_set_int(cd, "timestamp", (long long)now);
+}
+
+/* Start timing a switch, it ends when the destination rendered and the transition finished.
+ * Timing starts when the request was posted, or now when it did not go through the queue.
+ * Signals switch_started, and switch_completed as well when there is no frame to wait for.
+ * A switch replaced before its destination rendered never signals switch_completed. */
+static void switcher_latency_start(struct switcher_info *switcher, enum switcher_origin origin, uint64_t posted,
+				   obs_source_t *from, obs_source_t *to)
+{
+	const long long from_index = switcher_signal_index(switcher, from);
+	const long long to_index = switcher_signal_index(switcher, to);
+	char *from_name = from ? bstrdup(obs_source_get_name(from)) : NULL;
+	char *to_name = to ? bstrdup(obs_source_get_name(to)) : NULL;
+	calldata_t cd;
+	calldata_init(&cd);
+
+	pthread_mutex_lock(&switcher->latency_mutex);
+	switcher->switch_start = posted ? posted : os_gettime_ns();
+	switcher->last_origin = origin;
+	switcher->origin_count[origin]++;
+	switcher->await_first_frame = to && !switcher->audio_only;
+	switcher->await_transition_end = switcher->current_transition != NULL;
+	switcher->signal_from_index = from_index;
+	switcher->signal_to_index = to_index;
+	bfree(switcher->signal_from_name);
+	bfree(switcher->signal_to_name);
+	switcher->signal_from_name = from_name;
+	switcher->signal_to_name = to_name;
+	const bool completed = !switcher->await_first_frame;
+	switcher_signal_params(switcher, &cd, switcher->switch_start);
+	pthread_mutex_unlock(&switcher->latency_mutex);
+
+	signal_handler_t *sh = obs_source_get_signal_handler(switcher->source);
+	signal_handler_signal(sh, "switch_started", &cd);
+	if (completed)
+		signal_handler_signal(sh, "switch_completed", &cd);
+	calldata_free(&cd);
+}
+
+static void switcher_latency_render(struct switcher_info *switcher)
+{
+	bool first_frame = false;
+	bool transition_end = false;
+	calldata_t cd;
+
+	pthread_mutex_lock(&switcher->latency_mutex);
+	const uint64_t now = os_gettime_ns();
+	const uint64_t elapsed = now - switcher->switch_start;
+	if (switcher->await_first_frame && switcher->current_source && obs_source_get_width(switcher->current_source) &&
+	    obs_source_get_height(switcher->current_source)) {
+		switcher->await_first_frame = false;
+		switcher_latency_add(&switcher->first_frame_latency, elapsed);
+		first_frame = true;
+	}
+	if (switcher->await_transition_end && !switcher_transition_active(switcher->current_transition)) {
+		switcher->await_transition_end = false;
+		switcher_latency_add(&switcher->transition_latency, elapsed);
+		transition_end = true;
+	}
+	if (first_frame || transition_end) {
+		calldata_init(&cd);
+		switcher_signal_params(switcher, &cd, now);
+	}
+	pthread_mutex_unlock(&switcher->latency_mutex);
+
+	if (!first_frame && !transition_end)
+		return;
+	signal_handler_t *sh = obs_source_get_signal_handler(switcher->source);
+	if (first_frame)
+		signal_handler_signal(sh, "switch_completed", &cd);
+	if (transition_end)
+		signal_handler_signal(sh, "transition_ended", &cd);
+	calldata_free(&cd);
+}
+
+void switcher_latency_summary(struct switcher_info *switcher, struct switcher_latency_summary *first_frame,
+			      struct switcher_latency_summary *transition)
+{
+	pthread_mutex_lock(&switcher->latency_mutex);
+	switcher_latency_get(&switcher->first_frame_latency, first_frame);
+	switcher_latency_get(&switcher->transition_latency, transition);
+	pthread_mutex_unlock(&switcher->latency_mutex);
+}
+
+void switcher_latency_log(struct switcher_info *switcher)
+{
+	struct switcher_latency_summary first_frame;
+	struct switcher_latency_summary transition;
+	switcher_latency_summary(switcher, &first_frame, &transition);
+	blog(LOG_INFO,
+	     "[source-switcher: '%s'] %llu switches, first frame min %.2f avg %.2f p99 %.2f max %.2f ms, "
+	     "%llu transitions, done min %.2f avg %.2f p99 %.2f max %.2f ms, %llu late time switches, max %.2f ms",
+	     obs_source_get_name(switcher->source), (unsigned long long)first_frame.count, first_frame.min_ms,
+	     first_frame.avg_ms, first_frame.p99_ms, first_frame.max_ms, (unsigned long long)transition.count,
+	     transition.min_ms, transition.avg_ms, transition.p99_ms, transition.max_ms,
+	     (unsigned long long)switcher->time_switch_slips, (double)switcher->time_switch_max_slip / 1000000.0);
+}
+
+/* Keep the endpoints of the running transition referenced until it is
+ * cleared, so rendering it does not have to look them up every frame. */
+static void switcher_transition_hold(struct switcher_info *switcher, obs_source_t *source_a, obs_source_t *source_b)
+{
+	obs_source_t *prev_a = switcher->transition_a;
+	obs_source_t *prev_b = switcher->transition_b;
+	switcher->transition_a = obs_source_get_ref(source_a);
+	switcher->transition_b = obs_source_get_ref(source_b);
+	obs_source_release(prev_a);
+	obs_source_release(prev_b);
+}
+
+static void switcher_transition_stop(void *data, calldata_t *cd)
+{
+	struct switcher_info *switcher = data;
+	/* may come from the audio thread, the transition is torn down on the next frame */
+	if (calldata_ptr(cd, "source") == switcher->current_transition)
+		os_atomic_set_bool(&switcher->transition_stopped, true);
+}
+
+/* Run transition from the current source to dest, a different transition that is still running is ended first.
+ * The transition stays an active child, holding on to the outgoing source, until it signals transition_stop. */
+static void switcher_transition_start(struct switcher_info *switcher, obs_source_t *transition, int running, obs_source_t *dest)
+{
+	if (switcher->current_transition != transition)
+		switcher_transition_end(switcher);
+	os_atomic_set_bool(&switcher->transition_stopped, false);
+	obs_transition_set(transition, switcher->current_source);
+	obs_transition_start(transition, OBS_TRANSITION_MODE_AUTO, (uint32_t)switcher->transition_duration, dest);
+	if (!switcher->current_transition) {
+		switcher->current_transition = obs_source_get_ref(transition);
+		signal_handler_connect(obs_source_get_signal_handler(transition), "transition_stop", switcher_transition_stop,
+				       switcher);
+		obs_source_add_active_child(switcher->source, transition);
+	}
+	switcher->transition_running = running;
+	switcher_transition_hold(switcher, switcher->current_source, dest);
+}
+
+void switcher_transition_end(struct switcher_info *switcher)
+{
+	obs_source_t *transition = switcher->current_transition;
+	if (!transition)
+		return;
+	/* disconnect first, force_stop signals transition_stop as well */
+	signal_handler_disconnect(obs_source_get_signal_handler(transition), "transition_stop", switcher_transition_stop,
+				  switcher);
+	switcher->current_transition = NULL;
+	switcher->transition_running = TRANSITION_NONE;
+	os_atomic_set_bool(&switcher->transition_stopped, false);
+	obs_source_remove_active_child(switcher->source, transition);
+	obs_transition_force_stop(transition);
+	obs_transition_clear(transition);
+	switcher_transition_hold(switcher, NULL, NULL);
+	switcher->transition_size_valid = false;
+	obs_source_release(transition);
+}
+
+/* Source an audio only switcher fades out from, it stays active until the audio thread finished the fade. */
+static void switcher_audio_fade_set(struct switcher_info *switcher, obs_source_t *source)
+{
+	source = obs_source_get_ref(source);
+	if (source)
+		obs_source_add_active_child(switcher->source, source);
+	pthread_mutex_lock(&switcher->audio_fade_mutex);
+	obs_source_t *prev = switcher->audio_fade_source;
+	switcher->audio_fade_source = source;
+	switcher->audio_fade_pos = 0;
+	os_atomic_set_bool(&switcher->audio_fade_done, false);
+	pthread_mutex_unlock(&switcher->audio_fade_mutex);
+	if (prev) {
+		obs_source_remove_active_child(switcher->source, prev);
+		obs_source_release(prev);
+	}
+}
+
+static void switcher_audio_fade_finished(struct switcher_info *switcher)
+{
+	obs_source_t *source = NULL;
+	pthread_mutex_lock(&switcher->audio_fade_mutex);
+	if (os_atomic_load_bool(&switcher->audio_fade_done)) {
+		source = switcher->audio_fade_source;
+		switcher->audio_fade_source = NULL;
+		os_atomic_set_bool(&switcher->audio_fade_done, false);
+	}
+	pthread_mutex_unlock(&switcher->audio_fade_mutex);
+	if (source) {
+		obs_source_remove_active_child(switcher->source, source);
+		obs_source_release(source);
+	}
+}
+
+void switcher_index_changed(struct switcher_info *switcher)
+{
+	const enum switcher_origin origin = switcher->switch_origin;
+	const uint64_t posted = switcher->switch_posted;
+	switcher->switch_origin = SWITCHER_ORIGIN_OTHER;
+	switcher->switch_posted = 0;
+	if (!switcher->sources.num)
+		return;
+
+	if (switcher->current_index >= switcher->sources.num) {
+		switcher->current_index = switcher->loop ? 0 : switcher->sources.num - 1;
+	}
+	obs_source_t *dest = switcher->sources.array[switcher->current_index];
+	if (switcher->current_source == dest)
+		return;
+
+	obs_source_t *from = obs_source_get_ref(switcher->current_source);
+	obs_source_t *transition = switcher->transition;
+	obs_source_t *show_transition = switcher->show_transition;
+	if (switcher->transition_override_set) {
+		/* transition given with a proc call, NULL for a cut */
+		transition = switcher->transition_override;
+		show_transition = NULL;
+	}
+
+	if (!switcher->current_source && show_transition) {
+		if (!switcher->transition_resize) {
+			uint32_t cx = obs_source_get_width(dest);
+			uint32_t cy = obs_source_get_height(dest);
+			if (switcher->current_source) {
+				const uint32_t cxa = obs_source_get_width(switcher->current_source);
+				if (cxa > cx)
+					cx = cxa;
+				const uint32_t cya = obs_source_get_height(switcher->current_source);
+				if (cya > cy)
+					cy = cya;
+			}
+			obs_transition_set_size(show_transition, cx, cy);
+		} else {
+			obs_transition_set_size(show_transition, obs_source_get_width(switcher->current_source),
+						obs_source_get_height(switcher->current_source));
+		}
+		switcher_transition_start(switcher, show_transition, TRANSITION_SHOW, dest);
+		uint32_t cx;
+		uint32_t cy;
+		obs_transition_get_size(show_transition, &cx, &cy);
+		if (switcher->log)
+			blog(LOG_INFO, "[source-switcher: '%s'] show transition to '%s' using '%s' for %i ms, %s {%i,%i}",
+			     obs_source_get_name(switcher->source), obs_source_get_name(dest),
+			     obs_source_get_name(show_transition), (int)switcher->transition_duration,
+			     switcher->transition_resize ? "resize" : "fixed size", cx, cy);
+	} else if (transition) {
+		if (!switcher->transition_resize) {
+			uint32_t cx = obs_source_get_width(dest);
+			uint32_t cy = obs_source_get_height(dest);
+			if (switcher->current_source) {
+				const uint32_t cxa = obs_source_get_width(switcher->current_source);
+				if (cxa > cx)
+					cx = cxa;
+				const uint32_t cya = obs_source_get_height(switcher->current_source);
+				if (cya > cy)
+					cy = cya;
+			}
+			obs_transition_set_size(transition, cx, cy);
+		} else {
+			obs_transition_set_size(transition, obs_source_get_width(switcher->current_source),
+						obs_source_get_height(switcher->current_source));
+		}
+		switcher_transition_start(switcher, transition, TRANSITION_NORMAL, dest);
+		uint32_t cx;
+		uint32_t cy;
+		obs_transition_get_size(transition, &cx, &cy);
+		if (switcher->log)
+			blog(LOG_INFO, "[source-switcher: '%s'] transition to '%s' using '%s' for %i ms, %s {%i,%i}",
+			     obs_source_get_name(switcher->source), obs_source_get_name(dest),
+			     obs_source_get_name(transition), (int)switcher->transition_duration,
+			     switcher->transition_resize ? "resize" : "fixed size", cx, cy);
+	} else {
+		switcher_transition_end(switcher);
+		if (switcher->log)
+			blog(LOG_INFO, "[source-switcher: '%s'] switch to '%s'", obs_source_get_name(switcher->source),
+			     obs_source_get_name(dest));
+	}
+	/* take the destination out of the warm pool before the previous source goes in, so it can not be evicted */
+	obs_source_t *prev = switcher->current_source;
+	const bool preloaded = dest != prev && da_find(switcher->preloaded, &dest, 0) != DARRAY_INVALID;
+	switcher->current_source = obs_source_get_ref(dest);
+	obs_source_add_active_child(switcher->source, switcher->current_source);
+	if (switcher_warm_pool_take(switcher, switcher->current_source) || preloaded)
+		switcher_media_rewind(dest);
+	switcher->entry_start_time = obs_get_video_frame_time();
+	if (switcher->audio_only)
+		switcher_audio_fade_set(switcher, switcher->transition_duration ? prev : NULL);
+	if (prev) {
+		switcher_warm_pool_push(switcher, prev);
+		obs_source_release(prev);
+		obs_source_remove_active_child(switcher->source, prev);
+	}
+	if (switcher->current_source_file && switcher->current_source_file_path && strlen(switcher->current_source_file_path)) {
+		const char *source_name = switcher->current_source ? obs_source_get_name(switcher->current_source) : "";
+		switcher_writer_queue(switcher->current_source_file_path, source_name);
+		/* a name the watcher read before this write is stale */
+		switcher_post_source_file(switcher, NULL);
+	}
+	switcher->transition_size_valid = false;
+	switcher_latency_start(switcher, origin, posted, from, switcher->current_source);
+	obs_source_release(from);
+	switcher_lookahead_refresh(switcher);
+}
+
+/* Per instance xorshift64* generator, so picks do not depend on other users
+ * of rand() and a fixed seed gives the same sequence every time. */
+void switcher_random_seed(struct switcher_info *switcher, long long seed)
+{
+	switcher->random_seed = seed;
+	uint64_t state = seed ? (uint64_t)seed : os_gettime_ns() ^ (uint64_t)(uintptr_t)switcher;
+	/* splitmix64 step so small seeds still give a well mixed state */
+	state += 0x9e3779b97f4a7c15ULL;
+	state = (state ^ (state >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	state = (state ^ (state >> 27)) * 0x94d049bb133111ebULL;
+	state ^= state >> 31;
+	switcher->random_state = state ? state : 1;
+}
+
+static uint64_t switcher_random_next(struct switcher_info *switcher)
+{
+	uint64_t x = switcher->random_state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	switcher->random_state = x;
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+static size_t switcher_rand_below(struct switcher_info *switcher, size_t n)
+{
+	return (size_t)(switcher_random_next(switcher) % n);
+}
+
+static double switcher_rand_unit(struct switcher_info *switcher)
+{
+	return (double)(switcher_random_next(switcher) >> 11) / 9007199254740992.0;
+}
+
+/* Vose's alias method: O(n) to build once per list, O(1) per pick */
+static void switcher_alias_build(struct switcher_info *switcher)
+{
+	const size_t num = switcher->entries.num;
+	switcher->alias_dirty = false;
+	da_resize(switcher->alias_table, num);
+	double total = 0.0;
+	for (size_t i = 0; i < num; i++)
+		total += switcher->entries.array[i].weight;
+	if (!num || total <= 0.0) {
+		for (size_t i = 0; i < num; i++) {
+			switcher->alias_table.array[i].probability = 1.0;
+			switcher->alias_table.array[i].alias = i;
+		}
+		return;
+	}
+
+	size_t *small = bmalloc(sizeof(size_t) * num * 2);
+	size_t *large = small + num;
+	size_t num_small = 0;
+	size_t num_large = 0;
+	for (size_t i = 0; i < num; i++) {
+		const double scaled = switcher->entries.array[i].weight * (double)num / total;
+		switcher->alias_table.array[i].probability = scaled;
+		switcher->alias_table.array[i].alias = i;
+		if (scaled < 1.0)
+			small[num_small++] = i;
+		else
+			large[num_large++] = i;
+	}
+	while (num_small && num_large) {
+		const size_t s = small[--num_small];
+		const size_t l = large[num_large - 1];
+		switcher->alias_table.array[s].alias = l;
+		struct switcher_alias *column = &switcher->alias_table.array[l];
+		column->probability += switcher->alias_table.array[s].probability - 1.0;
+		if (column->probability < 1.0) {
+			num_large--;
+			small[num_small++] = l;
+		}
+	}
+	/* what is left is 1 up to rounding */
+	while (num_large)
+		switcher->alias_table.array[large[--num_large]].probability = 1.0;
+	while (num_small)
+		switcher->alias_table.array[small[--num_small]].probability = 1.0;
+	bfree(small);
+}
+
+static size_t switcher_random_weighted(struct switcher_info *switcher)
+{
+	if (switcher->alias_dirty || switcher->alias_table.num != switcher->sources.num)
+		switcher_alias_build(switcher);
+	const size_t i = switcher_rand_below(switcher, switcher->alias_table.num);
+	const struct switcher_alias *column = &switcher->alias_table.array[i];
+	return switcher_rand_unit(switcher) < column->probability ? i : column->alias;
+}
+
+static size_t switcher_random_index(struct switcher_info *switcher, size_t exclude)
+{
+	if (switcher->sources.num <= 1)
+		return 0;
+	if (switcher->entries.num != switcher->sources.num)
+		return switcher_rand_below(switcher, switcher->sources.num);
+	/* redraw when the pick is the current entry, give up when its weight dominates */
+	for (int tries = 0; tries < 32; tries++) {
+		const size_t pick = switcher_random_weighted(switcher);
+		if (pick != exclude)
+			return pick;
+	}
+	if (exclude >= switcher->sources.num)
+		return switcher_rand_below(switcher, switcher->sources.num);
+	const size_t r = switcher_rand_below(switcher, switcher->sources.num - 1);
+	return r < exclude ? r : r + 1;
+}
+
+/* new bag that does not start with the entry shown last, so nothing repeats across bags */
+static void switcher_shuffle_bag_fill(struct switcher_info *switcher)
+{
+	const size_t num = switcher->sources.num;
+	da_resize(switcher->shuffle_bag, num);
+	for (size_t i = 0; i < num; i++)
+		switcher->shuffle_bag.array[i] = i;
+	for (size_t i = num; i > 1; i--) {
+		const size_t j = switcher_rand_below(switcher, i);
+		const size_t tmp = switcher->shuffle_bag.array[i - 1];
+		switcher->shuffle_bag.array[i - 1] = switcher->shuffle_bag.array[j];
+		switcher->shuffle_bag.array[j] = tmp;
+	}
+	if (num > 1 && switcher->shuffle_bag.array[0] == switcher->current_index) {
+		const size_t j = 1 + switcher_rand_below(switcher, num - 1);
+		switcher->shuffle_bag.array[0] = switcher->shuffle_bag.array[j];
+		switcher->shuffle_bag.array[j] = switcher->current_index;
+	}
+	switcher->shuffle_pos = 0;
+}
+
+static size_t switcher_shuffle_next(struct switcher_info *switcher)
+{
+	if (switcher->shuffle_pos >= switcher->shuffle_bag.num || switcher->shuffle_bag.num != switcher->sources.num)
+		switcher_shuffle_bag_fill(switcher);
+	if (!switcher->shuffle_bag.num)
+		return 0;
+	return switcher->shuffle_bag.array[switcher->shuffle_pos++];
+}
+
+void switcher_shuffle(struct switcher_info *switcher)
+{
+	if (!switcher->sources.num)
+		return;
+	switcher_shuffle_bag_fill(switcher);
+	switcher->shuffle_order = true;
+	switcher->last_switch_time = obs_get_video_frame_time();
+	switcher->current_index = switcher_shuffle_next(switcher);
+	switcher_index_changed(switcher);
+}
+
+static bool switcher_shuffle_ordered(struct switcher_info *switcher, int32_t switch_to)
+{
+	return switcher->shuffle_order && switcher->shuffle_bag.num && switcher->shuffle_bag.num == switcher->sources.num &&
+	       (switch_to == SWITCH_NEXT || switch_to == SWITCH_PREVIOUS || switch_to == SWITCH_FIRST ||
+		switch_to == SWITCH_LAST);
+}
+
+/* Bag position a switch goes to from the entry at index, like the list order the shuffle
+ * hotkey used to write into the settings. Usually index is the entry the bag is at. */
+static size_t switcher_shuffle_order_pos(struct switcher_info *switcher, int32_t switch_to, size_t index)
+{
+	const size_t num = switcher->shuffle_bag.num;
+	const size_t at = switcher->shuffle_pos;
+	size_t pos = DARRAY_INVALID;
+	if (at && at <= num && switcher->shuffle_bag.array[at - 1] == index)
+		pos = at - 1;
+	else if (index < num)
+		pos = da_find(switcher->shuffle_bag, &index, 0);
+	if (switch_to == SWITCH_NEXT) {
+		if (pos == DARRAY_INVALID)
+			return 0;
+		if (pos + 1 < num)
+			return pos + 1;
+		return switcher->loop ? 0 : SWITCHER_INDEX_NONE;
+	} else if (switch_to == SWITCH_PREVIOUS) {
+		if (pos == DARRAY_INVALID)
+			return num - 1;
+		if (pos)
+			return pos - 1;
+		return switcher->loop ? num - 1 : SWITCHER_INDEX_NONE;
+	}
+	return switch_to == SWITCH_FIRST ? 0 : num - 1;
+}
+
+/* index the schedule picks after from, step is how many switches ahead that is */
+static size_t switcher_peek_index(struct switcher_info *switcher, int32_t switch_to, size_t from, size_t step)
+{
+	const size_t num = switcher->sources.num;
+	if (switcher_shuffle_ordered(switcher, switch_to)) {
+		if (step && (switch_to == SWITCH_FIRST || switch_to == SWITCH_LAST))
+			return SWITCHER_INDEX_NONE;
+		const size_t pos = switcher_shuffle_order_pos(switcher, switch_to, from);
+		return pos == SWITCHER_INDEX_NONE ? SWITCHER_INDEX_NONE : switcher->shuffle_bag.array[pos];
+	} else if (switch_to == SWITCH_NEXT) {
+		if (from + 1 < num)
+			return from + 1;
+		return switcher->loop ? 0 : SWITCHER_INDEX_NONE;
+	} else if (switch_to == SWITCH_PREVIOUS) {
+		if (from && from <= num)
+			return from - 1;
+		return switcher->loop ? num - 1 : SWITCHER_INDEX_NONE;
+	} else if (switch_to == SWITCH_RANDOM) {
+		return step < switcher->random_picks.num ? switcher->random_picks.array[step] : SWITCHER_INDEX_NONE;
+	} else if (switch_to == SWITCH_SHUFFLE) {
+		const size_t pos = switcher->shuffle_pos + step;
+		return pos < switcher->shuffle_bag.num && switcher->shuffle_bag.num == num ? switcher->shuffle_bag.array[pos]
+											   : SWITCHER_INDEX_NONE;
+	} else if (switch_to == SWITCH_FIRST) {
+		return step ? SWITCHER_INDEX_NONE : 0;
+	} else if (switch_to == SWITCH_LAST) {
+		return step ? SWITCHER_INDEX_NONE : num - 1;
+	}
+	return SWITCHER_INDEX_NONE;
+}
+
+/* Keep the sources the next lookahead switches will show active, so media,
+ * browser and capture sources are already running when the switch fires. */
+void switcher_lookahead_refresh(struct switcher_info *switcher)
+{
+	int32_t switch_to = SWITCH_NEXT;
+	if (switcher->time_switch)
+		switch_to = switcher->time_switch_to;
+	else if (switcher->media_state_switch)
+		switch_to = switcher->media_state_switch_to;
+
+	if (switch_to != SWITCH_RANDOM || !switcher->lookahead) {
+		da_free(switcher->random_picks);
+	} else {
+		while (switcher->random_picks.num > switcher->lookahead)
+			da_pop_back(switcher->random_picks);
+		while (switcher->sources.num > 1 && switcher->random_picks.num < switcher->lookahead) {
+			const size_t prev = switcher->random_picks.num ? *(size_t *)da_end(switcher->random_picks)
+								       : switcher->current_index;
+			const size_t pick = switcher_random_index(switcher, prev);
+			da_push_back(switcher->random_picks, &pick);
+		}
+	}
+
+	if (switch_to == SWITCH_SHUFFLE && switcher->lookahead && switcher->shuffle_bag.num != switcher->sources.num)
+		switcher_shuffle_bag_fill(switcher);
+
+	DARRAY(obs_source_t *) preload;
+	da_init(preload);
+	size_t index = switcher->current_index;
+	for (size_t step = 0; step < switcher->lookahead && switcher->sources.num; step++) {
+		index = switcher_peek_index(switcher, switch_to, index, step);
+		if (index >= switcher->sources.num)
+			break;
+		obs_source_t *source = switcher->sources.array[index];
+		if (source == switcher->current_source || da_find(preload, &source, 0) != DARRAY_INVALID)
+			continue;
+		da_push_back(preload, &source);
+	}
+
+	/* activate the new ones before the old ones are dropped, a source that stays never deactivates */
+	for (size_t i = 0; i < preload.num; i++) {
+		if (da_find(switcher->preloaded, &preload.array[i], 0) == DARRAY_INVALID)
+			obs_source_add_active_child(switcher->source, preload.array[i]);
+		preload.array[i] = obs_source_get_ref(preload.array[i]);
+	}
+	/* swap first, the old sources are only released once enumeration can no longer see them */
+	pthread_mutex_lock(&switcher->children_mutex);
+	DARRAY(obs_source_t *) old;
+	da_init(old);
+	da_move(old, switcher->preloaded);
+	da_move(switcher->preloaded, preload);
+	pthread_mutex_unlock(&switcher->children_mutex);
+	for (size_t i = 0; i < old.num; i++) {
+		if (da_find(switcher->preloaded, &old.array[i], 0) == DARRAY_INVALID)
+			obs_source_remove_active_child(switcher->source, old.array[i]);
+		obs_source_release(old.array[i]);
+	}
+	da_free(old);
+}
+
+void switcher_switch_to(struct switcher_info *switcher, int32_t switch_to)
+{
+	switcher->last_switch_time = obs_get_video_frame_time();
+	if (switch_to == SWITCH_NONE) {
+		const enum switcher_origin origin = switcher->switch_origin;
+		const uint64_t posted = switcher->switch_posted;
+		switcher->switch_origin = SWITCHER_ORIGIN_OTHER;
+		switcher->switch_posted = 0;
+		if (switcher->current_source) {
+			obs_source_t *from = obs_source_get_ref(switcher->current_source);
+			obs_source_t *transition = switcher->transition;
+			obs_source_t *hide_transition = switcher->hide_transition;
+			if (switcher->transition_override_set) {
+				transition = switcher->transition_override;
+				hide_transition = NULL;
+			}
+			if (switcher->audio_only)
+				switcher_audio_fade_set(switcher, switcher->transition_duration ? switcher->current_source : NULL);
+			switcher_warm_pool_push(switcher, switcher->current_source);
+			obs_source_release(switcher->current_source);
+			obs_source_remove_active_child(switcher->source, switcher->current_source);
+			if (hide_transition) {
+				obs_transition_set_size(hide_transition, obs_source_get_width(switcher->current_source),
+							obs_source_get_height(switcher->current_source));
+				switcher_transition_start(switcher, hide_transition, TRANSITION_HIDE, NULL);
+				if (switcher->log)
+					blog(LOG_INFO, "[source-switcher: '%s'] hide transition to none",
+					     obs_source_get_name(switcher->source));
+			} else if (transition) {
+				obs_transition_set_size(transition, obs_source_get_width(switcher->current_source),
+							obs_source_get_height(switcher->current_source));
+				switcher_transition_start(switcher, transition, TRANSITION_NORMAL, NULL);
+				if (switcher->log)
+					blog(LOG_INFO, "[source-switcher: '%s'] transition to none",
+					     obs_source_get_name(switcher->source));
+			} else {
+				switcher_transition_end(switcher);
+				if (switcher->log)
+					blog(LOG_INFO, "[source-switcher: '%s'] switch to none",
+					     obs_source_get_name(switcher->source));
+			}
+			switcher->current_source = NULL;
+			switcher->transition_size_valid = false;
+			switcher_latency_start(switcher, origin, posted, from, NULL);
+			obs_source_release(from);
+			switcher_lookahead_refresh(switcher);
+		}
+		return;
+	}
+	if (switcher_shuffle_ordered(switcher, switch_to)) {
+		const size_t pos = switcher_shuffle_order_pos(switcher, switch_to, switcher->current_index);
+		if (pos != SWITCHER_INDEX_NONE) {
+			switcher->current_index = switcher->shuffle_bag.array[pos];
+			switcher->shuffle_pos = pos + 1;
+		}
+	} else if (switch_to == SWITCH_NEXT) {
+		switcher->current_index++;
+	} else if (switch_to == SWITCH_PREVIOUS) {
+		if (!switcher->current_index) {
+			if (switcher->loop && switcher->sources.num) {
+				switcher->current_index = switcher->sources.num - 1;
+			}
+		} else {
+			switcher->current_index--;
+		}
+	} else if (switch_to == SWITCH_RANDOM) {
+		/* use the pick the lookahead already preloaded when it still applies */
+		if (switcher->random_picks.num && switcher->random_picks.array[0] != switcher->current_index &&
+		    switcher->random_picks.array[0] < switcher->sources.num) {
+			switcher->current_index = switcher->random_picks.array[0];
+			da_erase(switcher->random_picks, 0);
+		} else {
+			da_free(switcher->random_picks);
+			switcher->current_index = switcher_random_index(switcher, switcher->current_index);
+		}
+	} else if (switch_to == SWITCH_SHUFFLE) {
+		switcher->current_index = switcher_shuffle_next(switcher);
+	} else if (switch_to == SWITCH_FIRST) {
+		switcher->current_index = 0;
+	} else if (switch_to == SWITCH_LAST) {
+		if (switcher->sources.num)
+			switcher->current_index = switcher->sources.num - 1;
+	}
+	switcher_index_changed(switcher);
+}
+
+void switcher_switch_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	if (command->name) {
+		switcher->switch_origin = command->origin;
+		switcher->switch_posted = command->posted;
+		switcher_switch_to_name(switcher, command->name);
+	} else if (command->index >= 0) {
+		switcher->switch_origin = command->origin;
+		switcher->switch_posted = command->posted;
+		switcher_switch_to_index(switcher, (size_t)command->index);
+	} else if (command->switch_to != SWITCH_RANDOM || switcher->sources.num) {
+		switcher->switch_origin = command->origin;
+		switcher->switch_posted = command->posted;
+		switcher_switch_to(switcher, command->switch_to);
+	}
+}
+
+/* hotkey ids start at 0, which the map uses for empty slots */
+static inline const void *switcher_hotkey_key(obs_hotkey_id id)
+{
+	return (const void *)((uintptr_t)id + 1);
+}
+
+/* source hotkeys post their hotkey id, the tick looks up which index it belongs to */
+static bool switcher_source_hotkey_resolve(struct switcher_info *switcher, struct switcher_command *command)
+{
+	size_t source;
+	size_t index;
+	if (!switcher_map_get(&switcher->hotkey_sources, switcher_hotkey_key((obs_hotkey_id)command->index), &source) ||
+	    !switcher_map_get(&switcher->source_indexes, (const void *)source, &index))
+		return false;
+	command->proc = switcher_switch_command;
+	command->index = (long long)index;
+	return true;
+}
+
+static void switcher_source_hotkey_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	struct switcher_command resolved = *command;
+	if (switcher_source_hotkey_resolve(switcher, &resolved))
+		switcher_switch_command(switcher, &resolved);
+}
+
+void switcher_switch_source_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(hotkey);
+	if (!pressed)
+		return;
+	struct switcher_command command = {
+		.proc = switcher_source_hotkey_command,
+		.coalesce = true,
+		.origin = SWITCHER_ORIGIN_HOTKEY,
+		.index = (long long)id,
+	};
+	switcher_post_command(data, &command);
+}
+
+static void switcher_rename_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	switcher_source_renamed(switcher, command->prev_name, command->name);
+}
+
+void switcher_registry_init(void)
+{
+	pthread_mutex_init(&registry_mutex, NULL);
+	switcher_map_init(&registry, true);
+}
+
+void switcher_registry_free(void)
+{
+	for (size_t i = 0; i < registry.capacity; i++) {
+		if (!registry.items[i].key)
+			continue;
+		struct switcher_registry_entry *entry = (struct switcher_registry_entry *)registry.items[i].value;
+		da_free(entry->switchers);
+		bfree(entry);
+	}
+	switcher_map_free(&registry);
+	pthread_mutex_destroy(&registry_mutex);
+}
+
+static void registry_add(const char *name, struct switcher_info *switcher)
+{
+	size_t value;
+	struct switcher_registry_entry *entry;
+	if (switcher_map_get(&registry, name, &value)) {
+		entry = (struct switcher_registry_entry *)value;
+		/* a rename already moved the switcher here before its update got to the new name */
+		if (da_find(entry->switchers, &switcher, 0) != DARRAY_INVALID)
+			return;
+	} else {
+		entry = bzalloc(sizeof(struct switcher_registry_entry));
+		switcher_map_set(&registry, name, (size_t)entry);
+	}
+	da_push_back(entry->switchers, &switcher);
+}
+
+static void registry_remove(const char *name, struct switcher_info *switcher)
+{
+	size_t value;
+	if (!switcher_map_get(&registry, name, &value))
+		return;
+	struct switcher_registry_entry *entry = (struct switcher_registry_entry *)value;
+	for (size_t i = 0; i < entry->switchers.num; i++) {
+		if (entry->switchers.array[i] == switcher) {
+			da_erase(entry->switchers, i);
+			break;
+		}
+	}
+	if (!entry->switchers.num) {
+		switcher_map_remove(&registry, name);
+		da_free(entry->switchers);
+		bfree(entry);
+	}
+}
+
+static void switcher_registry_update(struct switcher_info *switcher, const struct switcher_map *old_names,
+				     const struct switcher_map *new_names)
+{
+	pthread_mutex_lock(&registry_mutex);
+	for (size_t i = 0; i < old_names->capacity; i++) {
+		const char *name = old_names->items[i].key;
+		if (name && !switcher_map_get(new_names, name, NULL))
+			registry_remove(name, switcher);
+	}
+	for (size_t i = 0; i < new_names->capacity; i++) {
+		const char *name = new_names->items[i].key;
+		if (name && !switcher_map_get(old_names, name, NULL))
+			registry_add(name, switcher);
+	}
+	pthread_mutex_unlock(&registry_mutex);
+}
+
+/* Leave the registry before the queue goes away, a rename on another thread could otherwise still
+ * post to it. Every name is checked, a rename moves the switcher before its name_indexes follow. */
+static void switcher_registry_leave(struct switcher_info *switcher)
+{
+	DARRAY(char *) names;
+	da_init(names);
+	pthread_mutex_lock(&registry_mutex);
+	for (size_t i = 0; i < registry.capacity; i++) {
+		struct switcher_registry_entry *entry = (struct switcher_registry_entry *)registry.items[i].value;
+		if (registry.items[i].key && da_find(entry->switchers, &switcher, 0) != DARRAY_INVALID) {
+			char *name = bstrdup(registry.items[i].key);
+			da_push_back(names, &name);
+		}
+	}
+	for (size_t i = 0; i < names.num; i++) {
+		registry_remove(names.array[i], switcher);
+		bfree(names.array[i]);
+	}
+	pthread_mutex_unlock(&registry_mutex);
+	da_free(names);
+}
+
+void switcher_registry_rename(const char *prev_name, const char *new_name, switcher_rename_proc_t proc)
+{
+	if (!prev_name || !new_name)
+		return;
+	pthread_mutex_lock(&registry_mutex);
+	size_t value;
+	if (!switcher_map_get(&registry, prev_name, &value)) {
+		pthread_mutex_unlock(&registry_mutex);
+		return;
+	}
+	struct switcher_registry_entry *entry = (struct switcher_registry_entry *)value;
+	switcher_map_remove(&registry, prev_name);
+	for (size_t i = 0; i < entry->switchers.num; i++) {
+		struct switcher_info *switcher = entry->switchers.array[i];
+		struct switcher_command command = {
+			.proc = switcher_rename_command,
+			.keep = true,
+			.name = bstrdup(new_name),
+			.prev_name = bstrdup(prev_name),
+		};
+		switcher_post_command(switcher, &command);
+		if (proc)
+			proc(switcher, prev_name, new_name);
+	}
+
+	if (switcher_map_get(&registry, new_name, &value)) {
+		/* switchers that already listed the new name are registered for it once */
+		struct switcher_registry_entry *existing = (struct switcher_registry_entry *)value;
+		for (size_t i = 0; i < entry->switchers.num; i++) {
+			bool found = false;
+			for (size_t j = 0; !found && j < existing->switchers.num; j++)
+				found = existing->switchers.array[j] == entry->switchers.array[i];
+			if (!found)
+				da_push_back(existing->switchers, &entry->switchers.array[i]);
+		}
+		da_free(entry->switchers);
+		bfree(entry);
+	} else {
+		switcher_map_set(&registry, new_name, (size_t)entry);
+	}
+	pthread_mutex_unlock(&registry_mutex);
+}
+
+void switcher_source_renamed(struct switcher_info *switcher, const char *prev_name, const char *new_name)
+{
+	size_t index;
+	if (!prev_name || !new_name || !switcher_map_get(&switcher->name_indexes, prev_name, &index))
+		return;
+	switcher_map_remove(&switcher->name_indexes, prev_name);
+	switcher_map_set(&switcher->name_indexes, new_name, index);
+}
+
+bool switcher_switch_to_index(struct switcher_info *switcher, size_t index)
+{
+	if (index >= switcher->sources.num) {
+		switcher->switch_origin = SWITCHER_ORIGIN_OTHER;
+		switcher->switch_posted = 0;
+		return false;
+	}
+	if (switcher->current_index != index || !switcher->current_source) {
+		switcher->last_switch_time = obs_get_video_frame_time();
+		switcher->current_index = index;
+		switcher_index_changed(switcher);
+	} else {
+		switcher->switch_origin = SWITCHER_ORIGIN_OTHER;
+		switcher->switch_posted = 0;
+	}
+	return true;
+}
+
+bool switcher_switch_to_name(struct switcher_info *switcher, const char *name)
+{
+	size_t index;
+	if (!switcher_map_get(&switcher->name_indexes, name, &index) || index == SWITCHER_INDEX_NONE) {
+		switcher->switch_origin = SWITCHER_ORIGIN_OTHER;
+		switcher->switch_posted = 0;
+		return false;
+	}
+	return switcher_switch_to_index(switcher, index);
+}
+
+bool switcher_post_command(struct switcher_info *switcher, struct switcher_command *command)
+{
+	command->posted = os_gettime_ns();
+	if (switcher_command_queue_push(&switcher->commands, command))
+		return true;
+	blog(LOG_WARNING, "[source-switcher: '%s'] command queue full, command dropped", obs_source_get_name(switcher->source));
+	return false;
+}
+
+/* net effect of a run of switch commands, the last command is kept to perform it */
+struct switcher_coalesce {
+	size_t count;
+	size_t index;
+	bool none;
+	bool random;
+	int32_t random_to;
+	/* the first request of the run, the switch is timed from there */
+	uint64_t posted;
+	struct switcher_command last;
+};
+
+static void switcher_coalesce_flush(struct switcher_info *switcher, struct switcher_coalesce *fold)
+{
+	if (!fold->count)
+		return;
+	struct switcher_command *command = &fold->last;
+	if (fold->count > 1) {
+		/* the last request carries the origin and transition, its target becomes the net one */
+		bfree(command->name);
+		command->name = NULL;
+		if (fold->random) {
+			command->index = -1;
+			command->switch_to = fold->random_to;
+		} else if (fold->none) {
+			command->index = -1;
+			command->switch_to = SWITCH_NONE;
+		} else {
+			command->index = (long long)fold->index;
+		}
+		command->posted = fold->posted;
+		switcher->switches_coalesced += fold->count - 1;
+		if (switcher->log)
+			blog(LOG_INFO, "[source-switcher: '%s'] collapsed %zu switch requests into one",
+			     obs_source_get_name(switcher->source), fold->count);
+	}
+	command->proc(switcher, command);
+	switcher_command_free(command);
+	fold->count = 0;
+}
+
+/* mirrors what switcher_switch_to and switcher_index_changed do to current_index */
+static void switcher_coalesce_add(struct switcher_info *switcher, struct switcher_coalesce *fold,
+				  struct switcher_command *command)
+{
+	const size_t num = switcher->sources.num;
+	const bool relative = !command->name && command->index < 0 &&
+			      (command->switch_to == SWITCH_NEXT || command->switch_to == SWITCH_PREVIOUS);
+	/* a step from a random pick needs the pick */
+	if (fold->count && fold->random && relative)
+		switcher_coalesce_flush(switcher, fold);
+	if (!fold->count) {
+		fold->index = switcher->current_index < num ? switcher->current_index : (switcher->loop ? 0 : num - 1);
+		fold->none = !switcher->current_source;
+		fold->random = false;
+		fold->posted = command->posted;
+	}
+
+	size_t index;
+	if (command->name) {
+		if (switcher_map_get(&switcher->name_indexes, command->name, &index) && index != SWITCHER_INDEX_NONE) {
+			fold->index = index;
+			fold->none = fold->random = false;
+		}
+	} else if (command->index >= 0) {
+		if ((size_t)command->index < num) {
+			fold->index = (size_t)command->index;
+			fold->none = fold->random = false;
+		}
+	} else if (command->switch_to == SWITCH_RANDOM || command->switch_to == SWITCH_SHUFFLE) {
+		fold->random = true;
+		fold->random_to = command->switch_to;
+		fold->none = false;
+	} else if (command->switch_to == SWITCH_NONE) {
+		fold->none = true;
+		fold->random = false;
+	} else {
+		if (command->switch_to == SWITCH_NEXT)
+			fold->index = fold->index + 1 < num ? fold->index + 1 : (switcher->loop ? 0 : num - 1);
+		else if (command->switch_to == SWITCH_PREVIOUS)
+			fold->index = fold->index ? fold->index - 1 : (switcher->loop ? num - 1 : 0);
+		else if (command->switch_to == SWITCH_FIRST)
+			fold->index = 0;
+		else if (command->switch_to == SWITCH_LAST)
+			fold->index = num - 1;
+		fold->none = fold->random = false;
+	}
+	if (fold->count)
+		switcher_command_free(&fold->last);
+	fold->last = *command;
+	fold->count++;
+}
+
+/* At most a queue worth per call, so a thread that keeps posting can not hold up the tick.
+ * Consecutive switch requests are collapsed into their net effect and switched once. */
+void switcher_commands_run(struct switcher_info *switcher)
+{
+	struct switcher_coalesce fold = {0};
+	struct switcher_command command;
+	for (size_t i = 0; i < SWITCHER_COMMAND_QUEUE_SIZE && switcher_command_queue_pop(&switcher->commands, &command); i++) {
+		if (command.proc == switcher_source_hotkey_command && !switcher_source_hotkey_resolve(switcher, &command)) {
+			switcher_command_free(&command);
+			continue;
+		}
+		if (command.coalesce && switcher->sources.num) {
+			switcher_coalesce_add(switcher, &fold, &command);
+			continue;
+		}
+		switcher_coalesce_flush(switcher, &fold);
+		command.proc(switcher, &command);
+		switcher_command_free(&command);
+	}
+	switcher_coalesce_flush(switcher, &fold);
+}
+
+void switcher_post_source_file(struct switcher_info *switcher, const char *name)
+{
+	pthread_mutex_lock(&switcher->source_file_mutex);
+	bfree(switcher->source_file_name);
+	switcher->source_file_name = bstrdup(name);
+	switcher->source_file_posted = os_gettime_ns();
+	os_atomic_set_bool(&switcher->source_file_changed, true);
+	pthread_mutex_unlock(&switcher->source_file_mutex);
+}
+
+static void switcher_apply_source_file(struct switcher_info *switcher, const char *source_name, uint64_t posted)
+{
+	if (strlen(source_name) == 0) {
+		if (switcher->current_source) {
+			switcher->switch_origin = SWITCHER_ORIGIN_FILE;
+			switcher->switch_posted = posted;
+			switcher_switch_to(switcher, SWITCH_NONE);
+		}
+	} else if (switcher->current_source && strcmp(obs_source_get_name(switcher->current_source), source_name) == 0) {
+	} else {
+		switcher->switch_origin = SWITCHER_ORIGIN_FILE;
+		switcher->switch_posted = posted;
+		switcher_switch_to_name(switcher, source_name);
+	}
+}
+
+static void switcher_register_source_hotkey(struct switcher_info *switcher, obs_source_t *source)
+{
+	struct switcher_hotkey_info h;
+	h.source = source;
+	h.hotkey_id = obs_hotkey_register_source(switcher->source, obs_source_get_name(source), obs_source_get_name(source),
+						 switcher_switch_source_hotkey, switcher);
+	da_push_back(switcher->hotkeys, &h);
+	switcher_map_set(&switcher->hotkey_sources, switcher_hotkey_key(h.hotkey_id), (size_t)(uintptr_t)source);
+	switcher_map_set(&switcher->source_hotkeys, source, h.hotkey_id);
+}
+
+static bool switcher_entry_hotkey(struct switcher_info *switcher, size_t index)
+{
+	return !switcher->hotkey_limit || index < switcher->hotkey_limit ||
+	       (index < switcher->entries.num && switcher->entries.array[index].hotkey);
+}
+
+/* Register hotkeys for the entries that should have one and unregister the rest, a source listed
+ * more than once gets a single hotkey for its first entry. */
+static void switcher_hotkeys_update(struct switcher_info *switcher)
+{
+	size_t keep = 0;
+	for (size_t i = 0; i < switcher->hotkeys.num; i++) {
+		const struct switcher_hotkey_info *h = &switcher->hotkeys.array[i];
+		size_t index;
+		if (switcher_map_get(&switcher->source_indexes, h->source, &index) && switcher_entry_hotkey(switcher, index)) {
+			switcher->hotkeys.array[keep++] = *h;
+		} else {
+			obs_hotkey_unregister(h->hotkey_id);
+			switcher_map_remove(&switcher->hotkey_sources, switcher_hotkey_key(h->hotkey_id));
+			switcher_map_remove(&switcher->source_hotkeys, h->source);
+		}
+	}
+	switcher->hotkeys.num = keep;
+
+	for (size_t i = 0; i < switcher->sources.num; i++) {
+		obs_source_t *source = switcher->sources.array[i];
+		size_t first;
+		if (!switcher_entry_hotkey(switcher, i) || !switcher_map_get(&switcher->source_indexes, source, &first) ||
+		    first != i || switcher_map_get(&switcher->source_hotkeys, source, NULL))
+			continue;
+		switcher_register_source_hotkey(switcher, source);
+	}
+	switcher->hotkeys_dirty = false;
+}
+
+void switcher_update_sources(struct switcher_info *switcher, const char **names, const struct switcher_entry *entries_in,
+			     size_t count)
+{
+	DARRAY(obs_source_t *) sources;
+	da_init(sources);
+	da_reserve(sources, count);
+	DARRAY(struct switcher_entry) entries;
+	da_init(entries);
+	da_reserve(entries, count);
+	bool changed = false;
+	for (size_t i = 0; i < count; i++) {
+		size_t index = SWITCHER_INDEX_NONE;
+		obs_source_t *source;
+		struct switcher_entry entry = {0, 0, 1.0, false};
+		if (entries_in) {
+			entry.duration = entries_in[i].duration;
+			entry.weight = entries_in[i].weight;
+			entry.hotkey = entries_in[i].hotkey;
+		}
+		if (!switcher_map_get(&switcher->name_indexes, names[i], &index))
+			changed = true;
+		/* entries that are already resolved keep their source, only unknown names need the global lookup */
+		if (index != SWITCHER_INDEX_NONE && !obs_source_removed(switcher->sources.array[index])) {
+			source = obs_source_get_ref(switcher->sources.array[index]);
+			entry.media_duration = switcher->entries.array[index].media_duration;
+			if (entry.hotkey != switcher->entries.array[index].hotkey)
+				switcher->hotkeys_dirty = true;
+		} else {
+			source = obs_get_source_by_name(names[i]);
+		}
+		if (source) {
+			da_push_back(sources, &source);
+			da_push_back(entries, &entry);
+		}
+	}
+	pthread_mutex_lock(&switcher->timeline_mutex);
+	da_move(switcher->entries, entries);
+	switcher->timeline_dirty = true;
+	switcher->alias_dirty = true;
+	pthread_mutex_unlock(&switcher->timeline_mutex);
+
+	if (sources.num != switcher->sources.num)
+		changed = true;
+	for (size_t i = 0; !changed && i < sources.num; i++) {
+		if (sources.array[i] != switcher->sources.array[i])
+			changed = true;
+	}
+
+	if (!changed) {
+		for (size_t i = 0; i < sources.num; i++)
+			obs_source_release(sources.array[i]);
+		da_free(sources);
+	} else {
+		struct switcher_map source_indexes;
+		switcher_map_init(&source_indexes, false);
+		switcher_map_reserve(&source_indexes, sources.num);
+		/* the first entry wins when a source is listed more than once */
+		for (size_t i = 0; i < sources.num; i++)
+			switcher_map_add(&source_indexes, sources.array[i], i);
+		switcher->hotkeys_dirty = true;
+
+		for (size_t i = 0; i < switcher->sources.num; i++)
+			obs_source_release(switcher->sources.array[i]);
+		da_move(switcher->sources, sources);
+		switcher_map_free(&switcher->source_indexes);
+		switcher->source_indexes = source_indexes;
+
+		struct switcher_map name_indexes;
+		switcher_map_init(&name_indexes, true);
+		switcher_map_reserve(&name_indexes, count);
+		for (size_t i = 0; i < switcher->sources.num; i++)
+			switcher_map_add(&name_indexes, obs_source_get_name(switcher->sources.array[i]), i);
+		for (size_t i = 0; i < count; i++)
+			switcher_map_add(&name_indexes, names[i], SWITCHER_INDEX_NONE);
+		switcher_registry_update(switcher, &switcher->name_indexes, &name_indexes);
+		switcher_map_free(&switcher->name_indexes);
+		switcher->name_indexes = name_indexes;
+		/* picks and the bag are indexes into the old list */
+		da_free(switcher->random_picks);
+		da_free(switcher->shuffle_bag);
+		switcher->shuffle_pos = 0;
+		switcher->shuffle_order = false;
+	}
+	if (switcher->hotkeys_dirty)
+		switcher_hotkeys_update(switcher);
+
+	if (!switcher->sources.num) {
+		switcher->current_index = 0;
+		if (switcher->current_source) {
+			obs_source_release(switcher->current_source);
+			obs_source_remove_active_child(switcher->source, switcher->current_source);
+			switcher->current_source = NULL;
+		}
+	} else {
+		if (switcher->current_source)
+			switcher_map_get(&switcher->source_indexes, switcher->current_source, &switcher->current_index);
+		switcher_index_changed(switcher);
+	}
+	switcher_warm_pool_trim(switcher);
+	switcher_lookahead_refresh(switcher);
+}
+
+void switcher_release(struct switcher_info *switcher)
+{
+	switcher_registry_leave(switcher);
+	switcher_command_queue_free(&switcher->commands);
+	if (switcher->current_source) {
+		obs_source_release(switcher->current_source);
+		obs_source_remove_active_child(switcher->source, switcher->current_source);
+		switcher->current_source = NULL;
+	}
+	switcher_transition_end(switcher);
+	switcher_audio_fade_set(switcher, NULL);
+	pthread_mutex_lock(&switcher->children_mutex);
+	DARRAY(obs_source_t *) preloaded;
+	da_init(preloaded);
+	da_move(preloaded, switcher->preloaded);
+	pthread_mutex_unlock(&switcher->children_mutex);
+	for (size_t i = 0; i < preloaded.num; i++) {
+		obs_source_remove_active_child(switcher->source, preloaded.array[i]);
+		obs_source_release(preloaded.array[i]);
+	}
+	da_free(preloaded);
+	da_free(switcher->random_picks);
+	da_free(switcher->shuffle_bag);
+	da_free(switcher->alias_table);
+	while (switcher->warm_pool.num)
+		switcher_warm_pool_evict(switcher, switcher->warm_pool.num - 1);
+	da_free(switcher->warm_pool);
+	for (size_t i = 0; i < switcher->sources.num; i++) {
+		obs_source_release(switcher->sources.array[i]);
+	}
+	da_free(switcher->sources);
+	da_free(switcher->hotkeys);
+	switcher_map_free(&switcher->hotkey_sources);
+	switcher_map_free(&switcher->source_hotkeys);
+	switcher_map_free(&switcher->source_indexes);
+	switcher_map_free(&switcher->name_indexes);
+	bfree(switcher->source_file_name);
+	switcher->source_file_name = NULL;
+	pthread_mutex_destroy(&switcher->source_file_mutex);
+	pthread_mutex_destroy(&switcher->latency_mutex);
+	bfree(switcher->signal_from_name);
+	bfree(switcher->signal_to_name);
+	switcher->signal_from_name = NULL;
+	switcher->signal_to_name = NULL;
+	pthread_mutex_destroy(&switcher->audio_fade_mutex);
+	pthread_mutex_destroy(&switcher->children_mutex);
+	obs_source_release(switcher->state_snapshot.current_source);
+	obs_source_release(switcher->state_snapshot.current_transition);
+	pthread_mutex_destroy(&switcher->state_mutex);
+	da_free(switcher->entries);
+	da_free(switcher->timeline);
+	pthread_mutex_destroy(&switcher->timeline_mutex);
+	bfree(switcher->profile_source_name);
+	switcher->profile_source_name = NULL;
+}
+
+bool switcher_transition_active(obs_source_t *transition)
+{
+	if (!transition)
+		return false;
+	const float t = obs_transition_get_time(transition);
+	return t >= 0.0f && t < 1.0f;
+}
+
+/* Size of a resizing transition, interpolated between the sizes of A and B.
+ * Done once per frame on the video thread, the tick publishes it for width and height and render reuses it. */
+static void switcher_transition_geometry(struct switcher_info *switcher)
+{
+	const uint64_t frame = obs_get_video_frame_time();
+	if (switcher->transition_size_valid && switcher->transition_size_frame == frame)
+		return;
+	profile_start("transition_size");
+	obs_source_t *source_a = switcher->transition_a;
+	obs_source_t *source_b = switcher->transition_b;
+	uint32_t cxa = 0;
+	uint32_t cya = 0;
+	uint32_t cxb = 0;
+	uint32_t cyb = 0;
+	if (source_a) {
+		cxa = obs_source_get_width(source_a);
+		cya = obs_source_get_height(source_a);
+	}
+	if (source_b) {
+		cxb = obs_source_get_width(source_b);
+		cyb = obs_source_get_height(source_b);
+	}
+	const float t = obs_transition_get_time(switcher->current_transition);
+	switcher->transition_cx = (cxa && cxb) ? (uint32_t)((1.0f - t) * (float)cxa + t * (float)cxb) : cxa + cxb;
+	switcher->transition_cy = (cya && cyb) ? (uint32_t)((1.0f - t) * (float)cya + t * (float)cyb) : cya + cyb;
+	switcher->transition_size_frame = frame;
+	switcher->transition_size_valid = true;
+	profile_end("transition_size");
+}
+
+static void switcher_render_cache_update(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	struct switcher_info *switcher = data;
+	os_atomic_set_bool(&switcher->render_cache_recheck, true);
+	os_atomic_set_bool(&switcher->render_cache_dirty, true);
+}
+
+static void switcher_render_cache_watch(struct switcher_info *switcher, obs_source_t *source)
+{
+	if (switcher->render_cache_source)
+		signal_handler_disconnect(obs_source_get_signal_handler(switcher->render_cache_source), "update",
+					  switcher_render_cache_update, switcher);
+	obs_source_release(switcher->render_cache_source);
+	switcher->render_cache_source = obs_source_get_ref(source);
+	if (source)
+		signal_handler_connect(obs_source_get_signal_handler(source), "update", switcher_render_cache_update, switcher);
+	os_atomic_set_bool(&switcher->render_cache_recheck, true);
+	os_atomic_set_bool(&switcher->render_cache_dirty, true);
+}
+
+/* Only sources that look the same until their settings change. An image source playing a gif
+ * does not, neither does a text source reading from a file, it reloads without signaling update. */
+static const char *render_cache_ids[] = {"image_source", "color_source", "text_gdiplus", "text_ft2_source", NULL};
+
+#define RENDER_CACHE_FILE_CHECK_NS 1000000000ULL
+/* image sources look at the modified time once a second, so they have reloaded after this long */
+#define RENDER_CACHE_FILE_RELOAD_NS 1500000000ULL
+
+static int64_t render_cache_file_mtime(const char *file)
+{
+	struct stat st;
+	return file && *file && os_stat(file, &st) == 0 ? (int64_t)st.st_mtime : -1;
+}
+
+static bool switcher_render_cacheable(struct switcher_info *switcher, obs_source_t *source)
+{
+	bfree(switcher->render_cache_file);
+	switcher->render_cache_file = NULL;
+	const char *id = obs_source_get_unversioned_id(source);
+	if (!id || (obs_source_get_output_flags(source) & (OBS_SOURCE_ASYNC | OBS_SOURCE_CONTROLLABLE_MEDIA)))
+		return false;
+	const char **cache_id = render_cache_ids;
+	while (*cache_id && strcmp(*cache_id, id) != 0)
+		cache_id++;
+	if (!*cache_id)
+		return false;
+	obs_data_t *settings = obs_source_get_settings(source);
+	bool cacheable = true;
+	if (strcmp(id, "image_source") == 0) {
+		const char *file = obs_data_get_string(settings, "file");
+		const char *ext = os_get_path_extension(file);
+		cacheable = !ext || astrcmpi(ext, ".gif") != 0;
+		if (cacheable) {
+			switcher->render_cache_file = bstrdup(file);
+			switcher->render_cache_file_mtime = render_cache_file_mtime(file);
+			switcher->render_cache_file_checked = obs_get_video_frame_time();
+		}
+	} else if (strcmp(id, "text_ft2_source") == 0) {
+		cacheable = !obs_data_get_bool(settings, "from_file");
+	} else if (strcmp(id, "text_gdiplus") == 0) {
+		cacheable = !obs_data_get_bool(settings, "read_from_file");
+	}
+	obs_data_release(settings);
+	return cacheable;
+}
+
+/* Once the image file changed the source is drawn directly until it surely reloaded, then cached again. */
+static bool switcher_render_cache_file_changed(struct switcher_info *switcher)
+{
+	if (!switcher->render_cache_file)
+		return false;
+	const uint64_t now = obs_get_video_frame_time();
+	if (now - switcher->render_cache_file_checked >= RENDER_CACHE_FILE_CHECK_NS) {
+		switcher->render_cache_file_checked = now;
+		const int64_t mtime = render_cache_file_mtime(switcher->render_cache_file);
+		if (mtime != switcher->render_cache_file_mtime) {
+			switcher->render_cache_file_mtime = mtime;
+			switcher->render_cache_file_until = now + RENDER_CACHE_FILE_RELOAD_NS;
+		}
+	}
+	if (now >= switcher->render_cache_file_until)
+		return false;
+	os_atomic_set_bool(&switcher->render_cache_dirty, true);
+	return true;
+}
+
+/* call from the graphics thread or with the graphics context entered */
+void switcher_render_cache_free(struct switcher_info *switcher)
+{
+	switcher_render_cache_watch(switcher, NULL);
+	gs_texrender_destroy(switcher->render_cache_texrender);
+	switcher->render_cache_texrender = NULL;
+	bfree(switcher->render_cache_file);
+	switcher->render_cache_file = NULL;
+}
+
+/* Draw the current source from the cache, it is only rendered again after it signals
+ * update or its size changes. Sources not in render_cache_ids are rendered as usual. */
+static bool switcher_render_cached(struct switcher_info *switcher, obs_source_t *source)
+{
+	if (source != switcher->render_cache_source)
+		switcher_render_cache_watch(switcher, source);
+	if (os_atomic_set_bool(&switcher->render_cache_recheck, false))
+		switcher->render_cache_cacheable = switcher_render_cacheable(switcher, source);
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+	if (!switcher->render_cache_cacheable || !cx || !cy || switcher_render_cache_file_changed(switcher))
+		return false;
+	if (!switcher->render_cache_texrender)
+		switcher->render_cache_texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	if (os_atomic_set_bool(&switcher->render_cache_dirty, false) || cx != switcher->render_cache_cx ||
+	    cy != switcher->render_cache_cy) {
+		gs_texrender_reset(switcher->render_cache_texrender);
+		if (!gs_texrender_begin(switcher->render_cache_texrender, cx, cy)) {
+			os_atomic_set_bool(&switcher->render_cache_dirty, true);
+			return false;
+		}
+		struct vec4 clear_color;
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+		obs_source_video_render(source);
+		gs_texrender_end(switcher->render_cache_texrender);
+		switcher->render_cache_cx = cx;
+		switcher->render_cache_cy = cy;
+		switcher->render_cache_misses++;
+	} else {
+		switcher->render_cache_hits++;
+	}
+
+	gs_texture_t *texture = gs_texrender_get_texture(switcher->render_cache_texrender);
+	if (!texture)
+		return false;
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(texture, 0, cx, cy);
+	gs_blend_state_pop();
+	return true;
+}
+
+void switcher_video_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(effect);
+	struct switcher_info *switcher = data;
+	const char *profile_name = switcher->profile_render;
+	profile_start(profile_name);
+	if (switcher->current_transition) {
+		if (switcher->transition_resize) {
+			switcher_transition_geometry(switcher);
+			obs_transition_set_size(switcher->current_transition, switcher->transition_cx, switcher->transition_cy);
+		}
+		obs_source_video_render(switcher->current_transition);
+		/* the transition signals its end while rendering its last frame, let go of it and the outgoing source now */
+		if (os_atomic_load_bool(&switcher->transition_stopped)) {
+			profile_start("transition_end");
+			switcher_transition_end(switcher);
+			profile_end("transition_end");
+		}
+	} else if (switcher->current_source) {
+		if (!switcher->render_cache || !switcher_render_cached(switcher, switcher->current_source))
+			obs_source_video_render(switcher->current_source);
+	}
+	if (switcher->await_first_frame || switcher->await_transition_end)
+		switcher_latency_render(switcher);
+	profile_end(profile_name);
+}
+
+/* video thread only, it dereferences the transition sources switcher_transition_end releases */
+static void switcher_size(struct switcher_info *switcher, uint32_t *cx, uint32_t *cy)
+{
+	if (switcher_transition_active(switcher->current_transition)) {
+		if (switcher->transition_resize) {
+			switcher_transition_geometry(switcher);
+			*cx = switcher->transition_cx;
+			*cy = switcher->transition_cy;
+		} else {
+			*cx = obs_source_get_width(switcher->current_transition);
+			*cy = obs_source_get_height(switcher->current_transition);
+		}
+	} else if (switcher->current_source) {
+		*cx = obs_source_get_width(switcher->current_source);
+		*cy = obs_source_get_height(switcher->current_source);
+	} else {
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t switcher_get_width(void *data)
+{
+	struct switcher_info *switcher = data;
+	pthread_mutex_lock(&switcher->state_mutex);
+	const uint32_t cx = switcher->state_snapshot.width;
+	pthread_mutex_unlock(&switcher->state_mutex);
+	return cx;
+}
+
+uint32_t switcher_get_height(void *data)
+{
+	struct switcher_info *switcher = data;
+	pthread_mutex_lock(&switcher->state_mutex);
+	const uint32_t cy = switcher->state_snapshot.height;
+	pthread_mutex_unlock(&switcher->state_mutex);
+	return cy;
+}
+
+/* how long an entry is shown: explicit duration, cached media duration, then the default */
+static uint64_t switcher_entry_dwell(struct switcher_info *switcher, size_t index)
+{
+	if (index < switcher->entries.num) {
+		const struct switcher_entry *entry = &switcher->entries.array[index];
+		if (entry->duration)
+			return entry->duration;
+		if (switcher->use_media_duration && entry->media_duration)
+			return entry->media_duration;
+	}
+	return switcher->time_switch ? switcher->time_switch_duration : 1000;
+}
+
+static uint64_t switcher_entry_length(struct switcher_info *switcher, size_t index)
+{
+	return switcher_entry_dwell(switcher, index) + (switcher->time_switch ? switcher->time_switch_between : 0);
+}
+
+/* call with timeline_mutex held */
+static void switcher_timeline_update(struct switcher_info *switcher)
+{
+	if (!switcher->timeline_dirty && switcher->timeline.num == switcher->entries.num + 1)
+		return;
+	da_resize(switcher->timeline, switcher->entries.num + 1);
+	uint64_t total = 0;
+	for (size_t i = 0; i < switcher->entries.num; i++) {
+		switcher->timeline.array[i] = total;
+		total += switcher_entry_length(switcher, i);
+	}
+	switcher->timeline.array[switcher->entries.num] = total;
+	switcher->timeline_dirty = false;
+}
+
+/* last entry starting at or before ms, call with timeline_mutex held */
+static size_t switcher_timeline_find(struct switcher_info *switcher, uint64_t ms)
+{
+	size_t low = 0;
+	size_t high = switcher->entries.num;
+	while (high - low > 1) {
+		const size_t mid = low + (high - low) / 2;
+		if (switcher->timeline.array[mid] <= ms)
+			low = mid;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+static void switcher_cache_media_duration(struct switcher_info *switcher)
+{
+	if (!switcher->current_source || switcher->current_index >= switcher->entries.num)
+		return;
+	struct switcher_entry *entry = &switcher->entries.array[switcher->current_index];
+	if (entry->media_duration)
+		return;
+	const int64_t duration = obs_source_media_get_duration(switcher->current_source);
+	if (duration <= 0)
+		return;
+	pthread_mutex_lock(&switcher->timeline_mutex);
+	entry->media_duration = (uint64_t)duration;
+	switcher->timeline_dirty = true;
+	pthread_mutex_unlock(&switcher->timeline_mutex);
+}
+
+/* Slots follow each other on an absolute timeline: a timed switch starts
+ * the next slot at the deadline it fired for, not at the frame it fired on,
+ * so the per frame overshoot does not add up. Any other switch restarts the
+ * timeline from that switch. */
+static void switcher_time_switch_tick(struct switcher_info *switcher)
+{
+	const uint64_t t = obs_get_video_frame_time();
+	if (switcher->last_switch_time != switcher->time_switch_synced) {
+		switcher->time_switch_start = switcher->last_switch_time;
+		switcher->time_switch_synced = switcher->last_switch_time;
+	}
+	const uint64_t slot = (switcher->current_source ? switcher_entry_dwell(switcher, switcher->current_index)
+							 : switcher->time_switch_between) *
+			      1000000ULL;
+	const uint64_t deadline = switcher->time_switch_start + slot;
+	if (t < deadline)
+		return;
+
+	const uint64_t slip = t - deadline;
+	switcher->switch_origin = SWITCHER_ORIGIN_TIME;
+	if (switcher->current_source && switcher->time_switch_between > 0) {
+		switcher_switch_to(switcher, SWITCH_NONE);
+	} else {
+		switcher_switch_to(switcher, switcher->time_switch_to);
+	}
+	/* after a stall or a pause longer than a slot start over instead of catching up */
+	switcher->time_switch_start = slip < slot ? deadline : t;
+	switcher->time_switch_synced = switcher->last_switch_time;
+	if (switcher->current_source)
+		switcher->entry_start_time = switcher->time_switch_start;
+
+	if (slip >= obs_get_frame_interval_ns() && slip < slot) {
+		switcher->time_switch_slips++;
+		if (slip > switcher->time_switch_max_slip)
+			switcher->time_switch_max_slip = slip;
+		if (switcher->log)
+			blog(LOG_INFO, "[source-switcher: '%s'] time switch %.2f ms late, frames were dropped",
+			     obs_source_get_name(switcher->source), (double)slip / 1000000.0);
+	}
+}
+
+/* the tick is the only writer, so it reads the snapshot without the lock and only references changed sources */
+static void switcher_state_publish(struct switcher_info *switcher)
+{
+	struct switcher_state_snapshot *snapshot = &switcher->state_snapshot;
+	const int64_t time = switcher_get_time(switcher);
+	const int64_t duration = switcher_get_duration(switcher);
+	uint32_t cx;
+	uint32_t cy;
+	switcher_size(switcher, &cx, &cy);
+	obs_source_t *old_source = NULL;
+	obs_source_t *old_transition = NULL;
+	pthread_mutex_lock(&switcher->state_mutex);
+	if (snapshot->current_source != switcher->current_source) {
+		old_source = snapshot->current_source;
+		snapshot->current_source = obs_source_get_ref(switcher->current_source);
+	}
+	if (snapshot->current_transition != switcher->current_transition) {
+		old_transition = snapshot->current_transition;
+		snapshot->current_transition = obs_source_get_ref(switcher->current_transition);
+	}
+	snapshot->current_index = switcher->current_index;
+	snapshot->total_sources = switcher->sources.num;
+	snapshot->transition_running = switcher->current_transition ? switcher->transition_running : TRANSITION_NONE;
+	snapshot->time = time;
+	snapshot->duration = duration;
+	snapshot->playing = switcher->state == OBS_MEDIA_STATE_PLAYING;
+	snapshot->width = cx;
+	snapshot->height = cy;
+	snapshot->last_origin = switcher->last_origin;
+	snapshot->time_switch_slips = switcher->time_switch_slips;
+	snapshot->time_switch_max_slip = switcher->time_switch_max_slip;
+	snapshot->switches_coalesced = switcher->switches_coalesced;
+	snapshot->render_cache_hits = switcher->render_cache_hits;
+	snapshot->render_cache_misses = switcher->render_cache_misses;
+	pthread_mutex_unlock(&switcher->state_mutex);
+	obs_source_release(old_source);
+	obs_source_release(old_transition);
+}
+
+void switcher_video_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	struct switcher_info *switcher = data;
+	switcher_profile_names_update(switcher);
+	const char *profile_name = switcher->profile_tick;
+	profile_start(profile_name);
+	switcher_commands_run(switcher);
+	/* the stop signal came from the audio thread, or nothing renders the transition to let it finish */
+	if (switcher->current_transition &&
+	    (os_atomic_load_bool(&switcher->transition_stopped) ||
+	     (!obs_source_showing(switcher->source) && !switcher_transition_active(switcher->current_transition))))
+		switcher_transition_end(switcher);
+	if (os_atomic_load_bool(&switcher->audio_fade_done))
+		switcher_audio_fade_finished(switcher);
+	if (switcher->latency_log_interval) {
+		const uint64_t t = obs_get_video_frame_time();
+		if (!switcher->latency_last_log || t < switcher->latency_last_log) {
+			switcher->latency_last_log = t;
+		} else if (t - switcher->latency_last_log > switcher->latency_log_interval * 1000000000ULL) {
+			switcher->latency_last_log = t;
+			switcher_latency_log(switcher);
+		}
+	}
+	if (switcher->use_media_duration)
+		switcher_cache_media_duration(switcher);
+	if (switcher->time_switch && switcher->state == OBS_MEDIA_STATE_PLAYING)
+		switcher_time_switch_tick(switcher);
+	if (switcher->media_state_switch && switcher->current_source) {
+		profile_start("media_state");
+		const uint64_t t = obs_get_video_frame_time();
+		const enum obs_media_state state = obs_source_media_get_state(switcher->current_source);
+		if (state != OBS_MEDIA_STATE_NONE &&
+		    (t < switcher->last_switch_time ||
+		     t - switcher->last_switch_time > 10000000UL)) { // wait 10 ms before start checking state
+			if (switcher->media_switch_state < 0) {
+				if (-switcher->media_switch_state != (int32_t)state) {
+					switcher->switch_origin = SWITCHER_ORIGIN_MEDIA_STATE;
+					switcher_switch_to(switcher, switcher->media_state_switch_to);
+				}
+			} else if (switcher->media_switch_state == (int32_t)state) {
+				switcher->switch_origin = SWITCHER_ORIGIN_MEDIA_STATE;
+				switcher_switch_to(switcher, switcher->media_state_switch_to);
+			} else if (state == OBS_MEDIA_STATE_PLAYING && switcher->media_switch_state == OBS_MEDIA_STATE_ENDED &&
+				   switcher->transition_running == TRANSITION_NONE) {
+				const int64_t duration = obs_source_media_get_duration(switcher->current_source);
+				if (duration) {
+					const int64_t time = obs_source_media_get_time(switcher->current_source);
+					if (time <= duration && duration - time < (int64_t)switcher->transition_duration) {
+						switcher->switch_origin = SWITCHER_ORIGIN_MEDIA_STATE;
+						switcher_switch_to(switcher, switcher->media_state_switch_to);
+					}
+				}
+			}
+		}
+		profile_end("media_state");
+	}
+	if (switcher->current_source_file) {
+		profile_start("file_poll");
+		if (switcher->current_source_file_watch) {
+			if (os_atomic_load_bool(&switcher->source_file_changed)) {
+				pthread_mutex_lock(&switcher->source_file_mutex);
+				char *source_name = switcher->source_file_name;
+				const uint64_t posted = switcher->source_file_posted;
+				switcher->source_file_name = NULL;
+				os_atomic_set_bool(&switcher->source_file_changed, false);
+				pthread_mutex_unlock(&switcher->source_file_mutex);
+				if (source_name && !switcher_writer_pending(switcher->current_source_file_path))
+					switcher_apply_source_file(switcher, source_name, posted);
+				bfree(source_name);
+			}
+		} else if (switcher->current_source_file_interval > 0 && switcher->current_source_file_path &&
+			   strlen(switcher->current_source_file_path)) {
+			switcher->current_source_file_duration += seconds;
+			if (switcher->current_source_file_duration * 1000.0f > switcher->current_source_file_interval) {
+				switcher->current_source_file_duration = 0.0f;
+				/* until our own write is done the file still has the name we switched away from */
+				char *source_name = switcher_writer_pending(switcher->current_source_file_path)
+							    ? NULL
+							    : os_quick_read_utf8_file(switcher->current_source_file_path);
+				if (source_name) {
+					switcher_apply_source_file(switcher, source_name, 0);
+					bfree(source_name);
+				}
+			}
+		}
+		profile_end("file_poll");
+	}
+	switcher_state_publish(switcher);
+	profile_end(profile_name);
+}
+
+/* copies the last published state, the caller releases the sources */
+void switcher_state_get(struct switcher_info *switcher, struct switcher_state_snapshot *snapshot)
+{
+	pthread_mutex_lock(&switcher->state_mutex);
+	*snapshot = switcher->state_snapshot;
+	snapshot->current_source = obs_source_get_ref(snapshot->current_source);
+	snapshot->current_transition = obs_source_get_ref(snapshot->current_transition);
+	pthread_mutex_unlock(&switcher->state_mutex);
+}
+
+int64_t switcher_get_duration(void *data)
+{
+	struct switcher_info *switcher = data;
+	pthread_mutex_lock(&switcher->timeline_mutex);
+	switcher_timeline_update(switcher);
+	const int64_t duration = (int64_t)switcher->timeline.array[switcher->entries.num];
+	pthread_mutex_unlock(&switcher->timeline_mutex);
+	return duration;
+}
+
+int64_t switcher_get_time(void *data)
+{
+	struct switcher_info *switcher = data;
+	pthread_mutex_lock(&switcher->timeline_mutex);
+	switcher_timeline_update(switcher);
+	const size_t index = switcher->current_index < switcher->entries.num ? switcher->current_index
+									      : switcher->entries.num;
+	const uint64_t start = switcher->timeline.array[index];
+	const uint64_t length = switcher->timeline.array[index < switcher->entries.num ? index + 1 : index] - start;
+	pthread_mutex_unlock(&switcher->timeline_mutex);
+	if (!switcher->time_switch && !switcher->use_media_duration)
+		return (int64_t)start;
+
+	const uint64_t t = obs_get_video_frame_time();
+	uint64_t offset = t > switcher->entry_start_time ? (t - switcher->entry_start_time) / 1000000ULL : 0;
+	if (offset > length)
+		offset = length;
+	return (int64_t)(start + offset);
+}
+
+void switcher_set_time(void *data, int64_t ms)
+{
+	struct switcher_info *switcher = data;
+	pthread_mutex_lock(&switcher->timeline_mutex);
+	switcher_timeline_update(switcher);
+	const uint64_t position = ms > 0 ? (uint64_t)ms : 0;
+	const size_t index = switcher_timeline_find(switcher, position);
+	uint64_t offset = position - switcher->timeline.array[index];
+	pthread_mutex_unlock(&switcher->timeline_mutex);
+
+	const uint64_t t = obs_get_video_frame_time();
+	switcher->last_switch_time = t;
+	switcher->switch_origin = SWITCHER_ORIGIN_MEDIA_TIME;
+	switcher->current_index = index;
+	switcher_index_changed(switcher);
+	if (!switcher->time_switch && !switcher->use_media_duration)
+		offset = 0;
+	if (offset > switcher_entry_dwell(switcher, index))
+		offset = switcher_entry_dwell(switcher, index);
+
+	if (offset * 1000000ULL > t)
+		offset = t / 1000000ULL;
+	/* continue the schedule and the progress from the offset within the entry */
+	switcher->entry_start_time = t - offset * 1000000ULL;
+	switcher->time_switch_start = switcher->entry_start_time;
+	switcher->time_switch_synced = switcher->last_switch_time;
+	if (offset && switcher->current_source && index < switcher->entries.num &&
+	    switcher->entries.array[index].media_duration > offset)
+		obs_source_media_set_time(switcher->current_source, (int64_t)offset);
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "source-switcher.h"
+#include "source-switcher-map.h"
+#include "source-switcher-latency.h"
+#include "source-switcher-queue.h"
+
+/* value in name_indexes for names in the settings that did not resolve to a source */
+#define SWITCHER_INDEX_NONE ((size_t)-1)
+
+struct switcher_hotkey_info {
+	obs_hotkey_id hotkey_id;
+	obs_source_t *source;
+};
+
+/* per entry of sources: an explicit duration from the settings and the media
+ * duration cached once it is known, both in ms and 0 when not set, the
+ * weight for random picks and whether it gets a hotkey beyond the limit */
+struct switcher_entry {
+	uint64_t duration;
+	uint64_t media_duration;
+	double weight;
+	bool hotkey;
+};
+
+/* one column of the alias table used for weighted random picks */
+struct switcher_alias {
+	double probability;
+	size_t alias;
+};
+
+/* what the get_state proc reports, published by the video tick, the sources hold a reference */
+struct switcher_state_snapshot {
+	size_t current_index;
+	obs_source_t *current_source;
+	size_t total_sources;
+	int transition_running;
+	obs_source_t *current_transition;
+	int64_t time;
+	int64_t duration;
+	bool playing;
+	/* size as of the last tick, get_width and get_height are called from the UI thread too */
+	uint32_t width;
+	uint32_t height;
+	/* counters for the switch_latency and render_cache procs */
+	enum switcher_origin last_origin;
+	uint64_t time_switch_slips;
+	uint64_t time_switch_max_slip;
+	uint64_t switches_coalesced;
+	uint64_t render_cache_hits;
+	uint64_t render_cache_misses;
+};
+
+struct switcher_info {
+	obs_source_t *source;
+	obs_source_t *current_source;
+	DARRAY(obs_source_t *) sources;
+	DARRAY(struct switcher_hotkey_info) hotkeys;
+	/* hotkey id + 1 to its source and source to its hotkey id */
+	struct switcher_map hotkey_sources;
+	struct switcher_map source_hotkeys;
+	/* only the first entries and those marked get a hotkey, 0 for all */
+	size_t hotkey_limit;
+	bool hotkeys_dirty;
+	struct switcher_map source_indexes;
+	struct switcher_map name_indexes;
+	DARRAY(struct switcher_entry) entries;
+	/* start of every entry in ms plus the total at the end, rebuilt when dirty */
+	DARRAY(uint64_t) timeline;
+	bool timeline_dirty;
+	pthread_mutex_t timeline_mutex;
+	bool use_media_duration;
+	uint64_t entry_start_time;
+	size_t current_index;
+	bool loop;
+	uint64_t last_switch_time;
+	bool log;
+	size_t lookahead;
+	DARRAY(obs_source_t *) preloaded;
+	/* libobs enumerates the active children from the audio thread, the tick changes preloaded and
+	 * warm_pool under it */
+	pthread_mutex_t children_mutex;
+	DARRAY(size_t) random_picks;
+	uint64_t random_state;
+	long long random_seed;
+	DARRAY(struct switcher_alias) alias_table;
+	bool alias_dirty;
+	/* Fisher-Yates permutation of the indexes, shown in order until used up */
+	DARRAY(size_t) shuffle_bag;
+	size_t shuffle_pos;
+	/* set by the shuffle hotkey, next, previous, first and last walk the bag until the list changes */
+	bool shuffle_order;
+	size_t warm_pool_size;
+	uint64_t warm_pool_budget;
+	DARRAY(obs_source_t *) warm_pool;
+
+	bool time_switch;
+	uint64_t time_switch_duration;
+	uint64_t time_switch_between;
+	int32_t time_switch_to;
+	/* start of the current slot on the absolute schedule, last_switch_time it was synced to */
+	uint64_t time_switch_start;
+	uint64_t time_switch_synced;
+	uint64_t time_switch_slips;
+	uint64_t time_switch_max_slip;
+
+	bool media_state_switch;
+	int32_t media_switch_state;
+	int32_t media_state_switch_to;
+
+	obs_source_t *transition;
+	obs_source_t *hide_transition;
+	obs_source_t *show_transition;
+	/* set while a transition runs, it is an active child until it signals transition_stop */
+	obs_source_t *current_transition;
+	/* A and B of current_transition, referenced while it runs */
+	obs_source_t *transition_a;
+	obs_source_t *transition_b;
+	int transition_running;
+	volatile bool transition_stopped;
+	/* set by proc calls for a single switch, transition_override NULL means cut */
+	bool transition_override_set;
+	obs_source_t *transition_override;
+	/* created on demand for transition types given to proc calls */
+	obs_source_t *proc_transition;
+	/* opt in: a static current source is drawn once into a texrender and the texture reused */
+	bool render_cache;
+	gs_texrender_t *render_cache_texrender;
+	obs_source_t *render_cache_source;
+	uint32_t render_cache_cx;
+	uint32_t render_cache_cy;
+	volatile bool render_cache_dirty;
+	/* set with dirty, the source is checked against render_cache_ids again */
+	volatile bool render_cache_recheck;
+	bool render_cache_cacheable;
+	/* image sources reload their file by themselves when its modified time changes */
+	char *render_cache_file;
+	int64_t render_cache_file_mtime;
+	uint64_t render_cache_file_checked;
+	uint64_t render_cache_file_until;
+	uint64_t render_cache_hits;
+	uint64_t render_cache_misses;
+	/* audio only switchers crossfade from the previous source instead of using transitions */
+	bool audio_only;
+	pthread_mutex_t audio_fade_mutex;
+	obs_source_t *audio_fade_source;
+	uint64_t audio_fade_pos;
+	volatile bool audio_fade_done;
+	bool transition_resize;
+	uint64_t transition_duration;
+	/* interpolated size during a resizing transition, computed once per frame */
+	bool transition_size_valid;
+	uint64_t transition_size_frame;
+	uint32_t transition_cx;
+	uint32_t transition_cy;
+	bool current_source_file;
+	char *current_source_file_path;
+	uint64_t current_source_file_interval;
+	float current_source_file_duration;
+	bool current_source_file_watch;
+	pthread_mutex_t source_file_mutex;
+	char *source_file_name;
+	uint64_t source_file_posted;
+	volatile bool source_file_changed;
+
+	enum obs_media_state state;
+	pthread_mutex_t state_mutex;
+	struct switcher_state_snapshot state_snapshot;
+
+	/* state changes posted from other threads, run by the video tick */
+	struct switcher_command_queue commands;
+	uint64_t switches_coalesced;
+
+	/* set by the caller right before a switch, consumed by the switch, posted is 0 when the
+	 * switch was not requested through the command queue or the file watcher */
+	enum switcher_origin switch_origin;
+	uint64_t switch_posted;
+	pthread_mutex_t latency_mutex;
+	uint64_t switch_start;
+	enum switcher_origin last_origin;
+	bool await_first_frame;
+	bool await_transition_end;
+	struct switcher_latency first_frame_latency;
+	struct switcher_latency transition_latency;
+	uint64_t origin_count[SWITCHER_ORIGIN_COUNT];
+	uint64_t latency_log_interval;
+	uint64_t latency_last_log;
+	/* the switch reported by the switch_started, switch_completed and transition_ended signals */
+	long long signal_from_index;
+	long long signal_to_index;
+	char *signal_from_name;
+	char *signal_to_name;
+
+	/* profiler scope names carrying the instance name, rebuilt on rename */
+	char *profile_source_name;
+	const char *profile_render;
+	const char *profile_tick;
+	const char *profile_audio;
+};
+
+/* The switching state machine. Everything in here only talks to libobs
+ * through the source, transition and hotkey API, so it can also be linked
+ * against the stand-in shim in bench/ to measure it headless. */
+
+void switcher_init(struct switcher_info *switcher, obs_source_t *source);
+void switcher_index_changed(struct switcher_info *switcher);
+void switcher_switch_to(struct switcher_info *switcher, int32_t switch_to);
+void switcher_shuffle(struct switcher_info *switcher);
+void switcher_switch_source_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+void switcher_update_sources(struct switcher_info *switcher, const char **names, const struct switcher_entry *entries,
+			     size_t count);
+void switcher_random_seed(struct switcher_info *switcher, long long seed);
+void switcher_release(struct switcher_info *switcher);
+void switcher_source_renamed(struct switcher_info *switcher, const char *prev_name, const char *new_name);
+bool switcher_switch_to_index(struct switcher_info *switcher, size_t index);
+bool switcher_switch_to_name(struct switcher_info *switcher, const char *name);
+void switcher_lookahead_refresh(struct switcher_info *switcher);
+void switcher_warm_pool_trim(struct switcher_info *switcher);
+void switcher_latency_summary(struct switcher_info *switcher, struct switcher_latency_summary *first_frame,
+			      struct switcher_latency_summary *transition);
+void switcher_latency_log(struct switcher_info *switcher);
+void switcher_profile_names_update(struct switcher_info *switcher);
+void switcher_post_source_file(struct switcher_info *switcher, const char *name);
+bool switcher_post_command(struct switcher_info *switcher, struct switcher_command *command);
+void switcher_switch_command(struct switcher_info *switcher, const struct switcher_command *command);
+void switcher_commands_run(struct switcher_info *switcher);
+
+/* Module wide map from source name to the switchers referencing it, so a
+ * rename only has to visit the switchers that list the renamed source. */
+typedef void (*switcher_rename_proc_t)(struct switcher_info *switcher, const char *prev_name, const char *new_name);
+
+void switcher_registry_init(void);
+void switcher_registry_free(void);
+void switcher_registry_rename(const char *prev_name, const char *new_name, switcher_rename_proc_t proc);
+
+bool switcher_transition_active(obs_source_t *transition);
+void switcher_transition_end(struct switcher_info *switcher);
+void switcher_render_cache_free(struct switcher_info *switcher);
+void switcher_video_render(void *data, gs_effect_t *effect);
+void switcher_video_tick(void *data, float seconds);
+uint32_t switcher_get_width(void *data);
+uint32_t switcher_get_height(void *data);
+
+void switcher_state_get(struct switcher_info *switcher, struct switcher_state_snapshot *snapshot);
+int64_t switcher_get_duration(void *data);
+int64_t switcher_get_time(void *data);
+void switcher_set_time(void *data, int64_t ms);
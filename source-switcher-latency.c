@@ -0,0 +1,47 @@
+#include "source-switcher-latency.h"
+#include <stdlib.h>
+
+static const char *origin_names[SWITCHER_ORIGIN_COUNT] = {
+	"other", "hotkey", "time", "media_state", "file", "proc", "media_control", "media_time",
+};
+
+const char *switcher_origin_name(enum switcher_origin origin)
+{
+	return origin < SWITCHER_ORIGIN_COUNT ? origin_names[origin] : origin_names[SWITCHER_ORIGIN_OTHER];
+}
+
+void switcher_latency_add(struct switcher_latency *latency, uint64_t ns)
+{
+	latency->samples[latency->count % SWITCHER_LATENCY_SAMPLES] = ns;
+	if (!latency->count || ns < latency->min)
+		latency->min = ns;
+	if (ns > latency->max)
+		latency->max = ns;
+	latency->total += ns;
+	latency->count++;
+}
+
+static int latency_compare(const void *a, const void *b)
+{
+	const uint64_t va = *(const uint64_t *)a;
+	const uint64_t vb = *(const uint64_t *)b;
+	return va < vb ? -1 : va > vb;
+}
+
+void switcher_latency_get(const struct switcher_latency *latency, struct switcher_latency_summary *summary)
+{
+	memset(summary, 0, sizeof(*summary));
+	summary->count = latency->count;
+	if (!latency->count)
+		return;
+	summary->min_ms = (double)latency->min / 1000000.0;
+	summary->max_ms = (double)latency->max / 1000000.0;
+	summary->avg_ms = (double)latency->total / (double)latency->count / 1000000.0;
+
+	const size_t num = latency->count < SWITCHER_LATENCY_SAMPLES ? (size_t)latency->count : SWITCHER_LATENCY_SAMPLES;
+	uint64_t sorted[SWITCHER_LATENCY_SAMPLES];
+	memcpy(sorted, latency->samples, num * sizeof(uint64_t));
+	qsort(sorted, num, sizeof(uint64_t), latency_compare);
+	const size_t p99 = (num * 99 + 99) / 100;
+	summary->p99_ms = (double)sorted[p99 - 1] / 1000000.0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <obs.h>
+
+/* Where a switch was triggered, kept with the latency samples so the
+ * statistics can tell hotkeys, schedules and remote control apart. */
+enum switcher_origin {
+	SWITCHER_ORIGIN_OTHER,
+	SWITCHER_ORIGIN_HOTKEY,
+	SWITCHER_ORIGIN_TIME,
+	SWITCHER_ORIGIN_MEDIA_STATE,
+	SWITCHER_ORIGIN_FILE,
+	SWITCHER_ORIGIN_PROC,
+	SWITCHER_ORIGIN_MEDIA_CONTROL,
+	SWITCHER_ORIGIN_MEDIA_TIME,
+	SWITCHER_ORIGIN_COUNT,
+};
+
+/* the percentile is taken over the most recent samples only */
+#define SWITCHER_LATENCY_SAMPLES 128
+
+struct switcher_latency {
+	uint64_t count;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+	uint64_t samples[SWITCHER_LATENCY_SAMPLES];
+};
+
+struct switcher_latency_summary {
+	uint64_t count;
+	double min_ms;
+	double avg_ms;
+	double p99_ms;
+	double max_ms;
+};
+
+const char *switcher_origin_name(enum switcher_origin origin);
+void switcher_latency_add(struct switcher_latency *latency, uint64_t ns);
+void switcher_latency_get(const struct switcher_latency *latency, struct switcher_latency_summary *summary);
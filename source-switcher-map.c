@@ -0,0 +1,174 @@
+#include "source-switcher-map.h"
+
+static uint64_t map_hash(const struct switcher_map *map, const void *key)
+{
+	uint64_t h;
+	if (map->string_keys) {
+		h = 14695981039346656037ULL;
+		for (const unsigned char *c = key; *c; c++) {
+			h ^= *c;
+			h *= 1099511628211ULL;
+		}
+	} else {
+		h = (uint64_t)(uintptr_t)key;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+	}
+	return h;
+}
+
+static bool map_key_equal(const struct switcher_map *map, const struct switcher_map_item *item, uint64_t hash, const void *key)
+{
+	if (item->hash != hash)
+		return false;
+	if (map->string_keys)
+		return strcmp(item->key, key) == 0;
+	return item->key == key;
+}
+
+static struct switcher_map_item *map_find(const struct switcher_map *map, const void *key, uint64_t hash)
+{
+	if (!map->capacity)
+		return NULL;
+	const size_t mask = map->capacity - 1;
+	for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+		struct switcher_map_item *item = &map->items[i];
+		if (!item->key)
+			return NULL;
+		if (map_key_equal(map, item, hash, key))
+			return item;
+	}
+}
+
+static void map_insert_item(struct switcher_map *map, const struct switcher_map_item *src)
+{
+	const size_t mask = map->capacity - 1;
+	size_t i = (size_t)src->hash & mask;
+	while (map->items[i].key)
+		i = (i + 1) & mask;
+	map->items[i] = *src;
+}
+
+static void map_grow(struct switcher_map *map, size_t capacity)
+{
+	size_t new_capacity = map->capacity ? map->capacity : 16;
+	while (new_capacity < capacity)
+		new_capacity *= 2;
+	if (new_capacity == map->capacity)
+		return;
+
+	struct switcher_map_item *old_items = map->items;
+	const size_t old_capacity = map->capacity;
+	map->items = bzalloc(sizeof(struct switcher_map_item) * new_capacity);
+	map->capacity = new_capacity;
+	for (size_t i = 0; i < old_capacity; i++) {
+		if (old_items[i].key)
+			map_insert_item(map, &old_items[i]);
+	}
+	bfree(old_items);
+}
+
+void switcher_map_init(struct switcher_map *map, bool string_keys)
+{
+	map->items = NULL;
+	map->capacity = 0;
+	map->num = 0;
+	map->string_keys = string_keys;
+}
+
+void switcher_map_clear(struct switcher_map *map)
+{
+	for (size_t i = 0; i < map->capacity; i++) {
+		if (map->string_keys)
+			bfree(map->items[i].key);
+		map->items[i].key = NULL;
+	}
+	map->num = 0;
+}
+
+void switcher_map_free(struct switcher_map *map)
+{
+	switcher_map_clear(map);
+	bfree(map->items);
+	map->items = NULL;
+	map->capacity = 0;
+}
+
+void switcher_map_reserve(struct switcher_map *map, size_t num)
+{
+	/* keep the load factor at or below one half */
+	map_grow(map, num * 2);
+}
+
+bool switcher_map_get(const struct switcher_map *map, const void *key, size_t *value)
+{
+	if (!key)
+		return false;
+	const struct switcher_map_item *item = map_find(map, key, map_hash(map, key));
+	if (!item)
+		return false;
+	if (value)
+		*value = item->value;
+	return true;
+}
+
+static struct switcher_map_item *map_insert(struct switcher_map *map, const void *key, uint64_t hash)
+{
+	map_grow(map, (map->num + 1) * 2);
+	struct switcher_map_item item;
+	item.hash = hash;
+	item.key = map->string_keys ? bstrdup(key) : (void *)key;
+	item.value = 0;
+	map_insert_item(map, &item);
+	map->num++;
+	return map_find(map, key, hash);
+}
+
+void switcher_map_set(struct switcher_map *map, const void *key, size_t value)
+{
+	if (!key)
+		return;
+	const uint64_t hash = map_hash(map, key);
+	struct switcher_map_item *item = map_find(map, key, hash);
+	if (!item)
+		item = map_insert(map, key, hash);
+	item->value = value;
+}
+
+bool switcher_map_add(struct switcher_map *map, const void *key, size_t value)
+{
+	if (!key)
+		return false;
+	const uint64_t hash = map_hash(map, key);
+	if (map_find(map, key, hash))
+		return false;
+	map_insert(map, key, hash)->value = value;
+	return true;
+}
+
+bool switcher_map_remove(struct switcher_map *map, const void *key)
+{
+	if (!key)
+		return false;
+	struct switcher_map_item *item = map_find(map, key, map_hash(map, key));
+	if (!item)
+		return false;
+	if (map->string_keys)
+		bfree(item->key);
+	item->key = NULL;
+	map->num--;
+
+	/* backward shift the rest of the probe sequence into the hole */
+	const size_t mask = map->capacity - 1;
+	size_t hole = (size_t)(item - map->items);
+	for (size_t i = (hole + 1) & mask; map->items[i].key; i = (i + 1) & mask) {
+		const size_t home = (size_t)map->items[i].hash & mask;
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			map->items[hole] = map->items[i];
+			map->items[i].key = NULL;
+			hole = i;
+		}
+	}
+	return true;
+}
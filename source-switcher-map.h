@@ -0,0 +1,28 @@
+#pragma once
+
+#include <obs.h>
+
+/* Open addressing hash map from a pointer or string key to a size_t value.
+ * String keys are copied, pointer keys are only compared by address. */
+
+struct switcher_map_item {
+	uint64_t hash;
+	void *key;
+	size_t value;
+};
+
+struct switcher_map {
+	struct switcher_map_item *items;
+	size_t capacity;
+	size_t num;
+	bool string_keys;
+};
+
+void switcher_map_init(struct switcher_map *map, bool string_keys);
+void switcher_map_free(struct switcher_map *map);
+void switcher_map_clear(struct switcher_map *map);
+void switcher_map_reserve(struct switcher_map *map, size_t num);
+bool switcher_map_get(const struct switcher_map *map, const void *key, size_t *value);
+void switcher_map_set(struct switcher_map *map, const void *key, size_t value);
+bool switcher_map_add(struct switcher_map *map, const void *key, size_t value);
+bool switcher_map_remove(struct switcher_map *map, const void *key);
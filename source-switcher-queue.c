@@ -0,0 +1,109 @@
+#include "source-switcher-queue.h"
+#include <util/bmem.h>
+#include <util/threading.h>
+
+#define QUEUE_MASK (SWITCHER_COMMAND_QUEUE_SIZE - 1)
+
+/* positions are compared through their difference so they may wrap */
+static inline long queue_diff(long a, long b)
+{
+	return (long)((unsigned long)a - (unsigned long)b);
+}
+
+void switcher_command_queue_init(struct switcher_command_queue *queue)
+{
+	for (long i = 0; i < SWITCHER_COMMAND_QUEUE_SIZE; i++)
+		os_atomic_set_long(&queue->slots[i].sequence, i);
+	os_atomic_set_long(&queue->head, 0);
+	queue->tail = 0;
+	os_atomic_set_long(&queue->dropped, 0);
+	pthread_mutex_init(&queue->overflow_mutex, NULL);
+	da_init(queue->overflow);
+	os_atomic_set_bool(&queue->overflowed, false);
+}
+
+void switcher_command_queue_free(struct switcher_command_queue *queue)
+{
+	struct switcher_command command;
+	while (switcher_command_queue_pop(queue, &command))
+		switcher_command_free(&command);
+	da_free(queue->overflow);
+	pthread_mutex_destroy(&queue->overflow_mutex);
+}
+
+/* kept commands after the first one that overflowed go to the list as well, so they run in order */
+static bool queue_overflow_push(struct switcher_command_queue *queue, struct switcher_command *command, bool full)
+{
+	pthread_mutex_lock(&queue->overflow_mutex);
+	const bool push = full || queue->overflow.num;
+	if (push) {
+		da_push_back(queue->overflow, command);
+		os_atomic_set_bool(&queue->overflowed, true);
+	}
+	pthread_mutex_unlock(&queue->overflow_mutex);
+	return push;
+}
+
+static bool queue_overflow_pop(struct switcher_command_queue *queue, struct switcher_command *command)
+{
+	pthread_mutex_lock(&queue->overflow_mutex);
+	const bool pop = queue->overflow.num > 0;
+	if (pop) {
+		*command = queue->overflow.array[0];
+		da_erase(queue->overflow, 0);
+		if (!queue->overflow.num)
+			os_atomic_set_bool(&queue->overflowed, false);
+	}
+	pthread_mutex_unlock(&queue->overflow_mutex);
+	return pop;
+}
+
+bool switcher_command_queue_push(struct switcher_command_queue *queue, struct switcher_command *command)
+{
+	if (command->keep && os_atomic_load_bool(&queue->overflowed) && queue_overflow_push(queue, command, false))
+		return true;
+	long pos = os_atomic_load_long(&queue->head);
+	struct switcher_command_slot *slot;
+	for (;;) {
+		slot = &queue->slots[pos & QUEUE_MASK];
+		const long diff = queue_diff(os_atomic_load_long(&slot->sequence), pos);
+		if (diff == 0) {
+			if (os_atomic_compare_exchange_long(&queue->head, &pos, (long)((unsigned long)pos + 1)))
+				break;
+		} else if (diff < 0) {
+			/* full, the consumer has not caught up with a whole queue of commands */
+			if (command->keep && queue_overflow_push(queue, command, true))
+				return true;
+			os_atomic_inc_long(&queue->dropped);
+			switcher_command_free(command);
+			return false;
+		} else {
+			pos = os_atomic_load_long(&queue->head);
+		}
+	}
+	slot->command = *command;
+	os_atomic_set_long(&slot->sequence, (long)((unsigned long)pos + 1));
+	return true;
+}
+
+bool switcher_command_queue_pop(struct switcher_command_queue *queue, struct switcher_command *command)
+{
+	struct switcher_command_slot *slot = &queue->slots[queue->tail & QUEUE_MASK];
+	const long next = (long)((unsigned long)queue->tail + 1);
+	if (queue_diff(os_atomic_load_long(&slot->sequence), next) != 0)
+		return os_atomic_load_bool(&queue->overflowed) && queue_overflow_pop(queue, command);
+	*command = slot->command;
+	os_atomic_set_long(&slot->sequence, (long)((unsigned long)queue->tail + SWITCHER_COMMAND_QUEUE_SIZE));
+	queue->tail = next;
+	return true;
+}
+
+void switcher_command_free(struct switcher_command *command)
+{
+	bfree(command->name);
+	bfree(command->prev_name);
+	bfree(command->transition);
+	command->name = NULL;
+	command->prev_name = NULL;
+	command->transition = NULL;
+}
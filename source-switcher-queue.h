@@ -0,0 +1,62 @@
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "source-switcher-latency.h"
+
+/* Bounded lock-free command queue, one per switcher. Hotkeys, media controls,
+ * proc calls and renames push commands from whatever thread they run on; the
+ * video tick is the only consumer and runs them, so the switching state is
+ * only changed on the graphics thread and the render path takes no locks.
+ * Every slot carries a sequence number (Vyukov's bounded queue): producers
+ * claim a position with a compare and swap on head, the consumer owns tail.
+ * Commands that must not get lost wait in a locked overflow list while the
+ * queue is full, the consumer takes them once the queue is empty. */
+
+#define SWITCHER_COMMAND_QUEUE_SIZE 64
+
+struct switcher_info;
+struct switcher_command;
+
+typedef void (*switcher_command_proc_t)(struct switcher_info *switcher, const struct switcher_command *command);
+
+/* name, prev_name and transition are owned by the command and freed after it ran or was dropped.
+ * coalesce marks a proc that only switches as given by switch_to, index or name, a run of those
+ * within one tick is collapsed into a single switch. keep marks a command that is never dropped,
+ * like renames and settings loads. */
+struct switcher_command {
+	switcher_command_proc_t proc;
+	bool coalesce;
+	bool keep;
+	enum switcher_origin origin;
+	/* os_gettime_ns when it was posted, switch latency is measured from here */
+	uint64_t posted;
+	int32_t switch_to;
+	long long index;
+	enum obs_media_state state;
+	char *name;
+	char *prev_name;
+	char *transition;
+};
+
+struct switcher_command_slot {
+	volatile long sequence;
+	struct switcher_command command;
+};
+
+struct switcher_command_queue {
+	struct switcher_command_slot slots[SWITCHER_COMMAND_QUEUE_SIZE];
+	volatile long head;
+	long tail;
+	volatile long dropped;
+	pthread_mutex_t overflow_mutex;
+	DARRAY(struct switcher_command) overflow;
+	volatile bool overflowed;
+};
+
+void switcher_command_queue_init(struct switcher_command_queue *queue);
+void switcher_command_queue_free(struct switcher_command_queue *queue);
+bool switcher_command_queue_push(struct switcher_command_queue *queue, struct switcher_command *command);
+bool switcher_command_queue_pop(struct switcher_command_queue *queue, struct switcher_command *command);
+void switcher_command_free(struct switcher_command *command);
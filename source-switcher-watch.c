@@ -0,0 +1,288 @@
+#include "source-switcher-watch.h"
+#include "source-switcher-writer.h"
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define WATCH_POLL_INTERVAL_MS 50
+
+struct switcher_watch {
+	struct switcher_info *switcher;
+	char *path;
+	const char *file;
+	char *last_content;
+	int wd;
+	bool dirty;
+};
+
+static pthread_mutex_t watch_mutex;
+static DARRAY(struct switcher_watch) watches;
+static pthread_t watch_thread;
+static bool watch_thread_active = false;
+static volatile bool watch_stop = false;
+
+#ifdef __linux__
+static int inotify_fd = -1;
+static int wake_fds[2] = {-1, -1};
+
+static void watch_wake(void)
+{
+	if (wake_fds[1] != -1) {
+		const char c = 0;
+		const ssize_t written = write(wake_fds[1], &c, 1);
+		UNUSED_PARAMETER(written);
+	}
+}
+
+static int watch_add_dir(const char *path)
+{
+	if (inotify_fd == -1)
+		return -1;
+	const char *slash = strrchr(path, '/');
+	char *dir = slash ? bstrdup_n(path, slash == path ? 1 : (size_t)(slash - path)) : bstrdup(".");
+	/* the directory is watched so files replaced by a rename are seen as well */
+	const int wd = inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0)
+		blog(LOG_WARNING, "[source-switcher] unable to watch '%s' for changes", dir);
+	bfree(dir);
+	return wd;
+}
+
+static void watch_remove_dir(int wd)
+{
+	if (wd < 0)
+		return;
+	for (size_t i = 0; i < watches.num; i++) {
+		if (watches.array[i].wd == wd)
+			return;
+	}
+	inotify_rm_watch(inotify_fd, wd);
+}
+
+static void watch_read_events(void)
+{
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	for (;;) {
+		const ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+		if (len <= 0)
+			break;
+		for (char *ptr = buffer; ptr < buffer + len;) {
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			for (size_t i = 0; event->len && i < watches.num; i++) {
+				if (watches.array[i].wd == event->wd && strcmp(watches.array[i].file, event->name) == 0)
+					watches.array[i].dirty = true;
+			}
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+#else
+static void watch_wake(void) {}
+
+static int watch_add_dir(const char *path)
+{
+	UNUSED_PARAMETER(path);
+	return -1;
+}
+
+static void watch_remove_dir(int wd)
+{
+	UNUSED_PARAMETER(wd);
+}
+#endif
+
+static size_t watch_find(struct switcher_info *switcher)
+{
+	for (size_t i = 0; i < watches.num; i++) {
+		if (watches.array[i].switcher == switcher)
+			return i;
+	}
+	return DARRAY_INVALID;
+}
+
+struct watch_read {
+	struct switcher_info *switcher;
+	char *path;
+	char *content;
+};
+
+/* Files are read with the mutex released so adding or removing a watch never waits on
+ * the disk, the result is only posted when the switcher still watches the same path.
+ * Entries inotify could not watch are read every time. Returns whether there are any. */
+static bool watch_read_dirty(bool all)
+{
+	DARRAY(struct watch_read) reads;
+	da_init(reads);
+	bool polled = false;
+	pthread_mutex_lock(&watch_mutex);
+	for (size_t i = 0; i < watches.num; i++) {
+		struct switcher_watch *watch = &watches.array[i];
+		polled = polled || watch->wd < 0;
+		if (!watch->dirty && !all && watch->wd >= 0)
+			continue;
+		watch->dirty = false;
+		struct watch_read read = {watch->switcher, bstrdup(watch->path), NULL};
+		da_push_back(reads, &read);
+	}
+	pthread_mutex_unlock(&watch_mutex);
+
+	for (size_t i = 0; i < reads.num; i++) {
+		char *content = os_quick_read_utf8_file(reads.array[i].path);
+		/* the switcher is about to replace this name, the write signals again once it is done */
+		if (content && switcher_writer_pending(reads.array[i].path)) {
+			bfree(content);
+			content = NULL;
+		}
+		reads.array[i].content = content;
+	}
+
+	pthread_mutex_lock(&watch_mutex);
+	for (size_t i = 0; i < reads.num; i++) {
+		struct watch_read *read = &reads.array[i];
+		const size_t idx = read->content ? watch_find(read->switcher) : DARRAY_INVALID;
+		if (idx != DARRAY_INVALID && strcmp(watches.array[idx].path, read->path) == 0 &&
+		    (!watches.array[idx].last_content || strcmp(watches.array[idx].last_content, read->content) != 0)) {
+			bfree(watches.array[idx].last_content);
+			watches.array[idx].last_content = bstrdup(read->content);
+			switcher_post_source_file(read->switcher, read->content);
+		}
+		bfree(read->path);
+		bfree(read->content);
+	}
+	pthread_mutex_unlock(&watch_mutex);
+	da_free(reads);
+	return polled;
+}
+
+static void *watch_thread_proc(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("source-switcher: file watcher");
+	bool polled = false;
+	while (!os_atomic_load_bool(&watch_stop)) {
+#ifdef __linux__
+		if (inotify_fd != -1) {
+			struct pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {wake_fds[0], POLLIN, 0}};
+			if (poll(fds, 2, polled ? WATCH_POLL_INTERVAL_MS : -1) < 0 && errno != EINTR)
+				break;
+			if (fds[1].revents & POLLIN) {
+				char c[64];
+				while (read(wake_fds[0], c, sizeof(c)) > 0) {
+				}
+			}
+			if (fds[0].revents & POLLIN) {
+				pthread_mutex_lock(&watch_mutex);
+				watch_read_events();
+				pthread_mutex_unlock(&watch_mutex);
+			}
+			polled = watch_read_dirty(false);
+			continue;
+		}
+#endif
+		watch_read_dirty(true);
+		os_sleep_ms(WATCH_POLL_INTERVAL_MS);
+	}
+	return NULL;
+}
+
+void switcher_watch_init(void)
+{
+	pthread_mutex_init(&watch_mutex, NULL);
+	da_init(watches);
+}
+
+void switcher_watch_free(void)
+{
+	if (watch_thread_active) {
+		os_atomic_set_bool(&watch_stop, true);
+		watch_wake();
+		pthread_join(watch_thread, NULL);
+		watch_thread_active = false;
+	}
+	for (size_t i = 0; i < watches.num; i++) {
+		bfree(watches.array[i].path);
+		bfree(watches.array[i].last_content);
+	}
+	da_free(watches);
+#ifdef __linux__
+	if (inotify_fd != -1)
+		close(inotify_fd);
+	if (wake_fds[0] != -1) {
+		close(wake_fds[0]);
+		close(wake_fds[1]);
+	}
+	inotify_fd = -1;
+	wake_fds[0] = wake_fds[1] = -1;
+#endif
+	pthread_mutex_destroy(&watch_mutex);
+}
+
+static void watch_start_thread(void)
+{
+	if (watch_thread_active)
+		return;
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd != -1 && pipe(wake_fds) == 0) {
+		fcntl(wake_fds[0], F_SETFL, O_NONBLOCK);
+	} else if (inotify_fd != -1) {
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+#endif
+	os_atomic_set_bool(&watch_stop, false);
+	watch_thread_active = pthread_create(&watch_thread, NULL, watch_thread_proc, NULL) == 0;
+}
+
+static void watch_erase(size_t idx)
+{
+	const int wd = watches.array[idx].wd;
+	bfree(watches.array[idx].path);
+	bfree(watches.array[idx].last_content);
+	da_erase(watches, idx);
+	watch_remove_dir(wd);
+}
+
+void switcher_watch_add(struct switcher_info *switcher, const char *path)
+{
+	if (!path || !*path) {
+		switcher_watch_remove(switcher);
+		return;
+	}
+	pthread_mutex_lock(&watch_mutex);
+	size_t idx = watch_find(switcher);
+	if (idx != DARRAY_INVALID && strcmp(watches.array[idx].path, path) == 0) {
+		pthread_mutex_unlock(&watch_mutex);
+		return;
+	}
+	if (idx != DARRAY_INVALID)
+		watch_erase(idx);
+
+	watch_start_thread();
+	struct switcher_watch *watch = da_push_back_new(watches);
+	watch->switcher = switcher;
+	watch->path = bstrdup(path);
+	const char *slash = strrchr(watch->path, '/');
+	watch->file = slash ? slash + 1 : watch->path;
+	watch->wd = watch_add_dir(watch->path);
+	/* pick up the current content once */
+	watch->dirty = true;
+	pthread_mutex_unlock(&watch_mutex);
+	watch_wake();
+}
+
+void switcher_watch_remove(struct switcher_info *switcher)
+{
+	pthread_mutex_lock(&watch_mutex);
+	const size_t idx = watch_find(switcher);
+	if (idx != DARRAY_INVALID)
+		watch_erase(idx);
+	pthread_mutex_unlock(&watch_mutex);
+}
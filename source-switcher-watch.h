@@ -0,0 +1,14 @@
+#pragma once
+
+#include "source-switcher-core.h"
+
+/* Background watcher for the current source file. A single thread serves
+ * all switchers: on Linux it sleeps on inotify, on Windows, macOS and for
+ * paths inotify cannot watch it polls the files every WATCH_POLL_INTERVAL_MS.
+ * Whenever the content changes the new name is posted to the switcher with
+ * switcher_post_source_file and applied on its next tick. */
+
+void switcher_watch_init(void);
+void switcher_watch_free(void);
+void switcher_watch_add(struct switcher_info *switcher, const char *path);
+void switcher_watch_remove(struct switcher_info *switcher);
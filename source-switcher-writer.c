@@ -0,0 +1,134 @@
+#include "source-switcher-writer.h"
+#include "source-switcher-map.h"
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+struct switcher_write {
+	char *path;
+	char *content;
+};
+
+static pthread_mutex_t writer_mutex;
+static DARRAY(struct switcher_write) writer_queue;
+static struct switcher_map writer_paths;
+/* paths taken by the thread and not written yet */
+static struct switcher_map writer_busy;
+static os_event_t *writer_event = NULL;
+static pthread_t writer_thread;
+static bool writer_thread_active = false;
+static volatile bool writer_stop = false;
+static volatile long writer_written = 0;
+static volatile long writer_coalesced = 0;
+
+static void writer_flush(void)
+{
+	DARRAY(struct switcher_write) queue;
+	da_init(queue);
+	pthread_mutex_lock(&writer_mutex);
+	da_move(queue, writer_queue);
+	switcher_map_clear(&writer_paths);
+	for (size_t i = 0; i < queue.num; i++)
+		switcher_map_set(&writer_busy, queue.array[i].path, 0);
+	pthread_mutex_unlock(&writer_mutex);
+
+	for (size_t i = 0; i < queue.num; i++) {
+		struct switcher_write *item = &queue.array[i];
+		if (!os_quick_write_utf8_file_safe(item->path, item->content, strlen(item->content), false, "tmp", NULL))
+			blog(LOG_WARNING, "[source-switcher] unable to write current source to '%s'", item->path);
+		os_atomic_inc_long(&writer_written);
+		pthread_mutex_lock(&writer_mutex);
+		switcher_map_remove(&writer_busy, item->path);
+		pthread_mutex_unlock(&writer_mutex);
+		bfree(item->path);
+		bfree(item->content);
+	}
+	da_free(queue);
+}
+
+static void *writer_thread_proc(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("source-switcher: file writer");
+	while (!os_atomic_load_bool(&writer_stop)) {
+		os_event_wait(writer_event);
+		writer_flush();
+	}
+	/* whatever was queued last still ends up on disk */
+	writer_flush();
+	return NULL;
+}
+
+void switcher_writer_init(void)
+{
+	pthread_mutex_init(&writer_mutex, NULL);
+	da_init(writer_queue);
+	switcher_map_init(&writer_paths, true);
+	switcher_map_init(&writer_busy, true);
+	os_event_init(&writer_event, OS_EVENT_TYPE_AUTO);
+	os_atomic_set_bool(&writer_stop, false);
+	writer_thread_active = pthread_create(&writer_thread, NULL, writer_thread_proc, NULL) == 0;
+}
+
+void switcher_writer_free(void)
+{
+	if (writer_thread_active) {
+		os_atomic_set_bool(&writer_stop, true);
+		os_event_signal(writer_event);
+		pthread_join(writer_thread, NULL);
+		writer_thread_active = false;
+	}
+	writer_flush();
+	da_free(writer_queue);
+	switcher_map_free(&writer_paths);
+	switcher_map_free(&writer_busy);
+	os_event_destroy(writer_event);
+	writer_event = NULL;
+	pthread_mutex_destroy(&writer_mutex);
+}
+
+void switcher_writer_queue(const char *path, const char *content)
+{
+	if (!path || !*path)
+		return;
+	if (!content)
+		content = "";
+	if (!writer_thread_active) {
+		os_quick_write_utf8_file_safe(path, content, strlen(content), false, "tmp", NULL);
+		return;
+	}
+
+	pthread_mutex_lock(&writer_mutex);
+	size_t idx;
+	if (switcher_map_get(&writer_paths, path, &idx)) {
+		/* not written yet, replace it with the latest name */
+		bfree(writer_queue.array[idx].content);
+		writer_queue.array[idx].content = bstrdup(content);
+		os_atomic_inc_long(&writer_coalesced);
+	} else {
+		struct switcher_write item = {bstrdup(path), bstrdup(content)};
+		switcher_map_set(&writer_paths, path, da_push_back(writer_queue, &item));
+	}
+	pthread_mutex_unlock(&writer_mutex);
+	os_event_signal(writer_event);
+}
+
+bool switcher_writer_pending(const char *path)
+{
+	if (!path || !*path || !writer_thread_active)
+		return false;
+	pthread_mutex_lock(&writer_mutex);
+	const bool pending = switcher_map_get(&writer_paths, path, NULL) || switcher_map_get(&writer_busy, path, NULL);
+	pthread_mutex_unlock(&writer_mutex);
+	return pending;
+}
+
+long switcher_writer_written(void)
+{
+	return os_atomic_load_long(&writer_written);
+}
+
+long switcher_writer_coalesced(void)
+{
+	return os_atomic_load_long(&writer_coalesced);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <obs.h>
+
+/* Write-behind for the current source file. Writes are queued and done by
+ * a single module wide thread; when several names are queued for the same
+ * path before the thread gets to it only the latest is written. Files are
+ * replaced through a temporary file so readers never see a partial name.
+ * Until a queued write is done the file still holds the previous name, so
+ * readers of the same path check switcher_writer_pending first. */
+
+void switcher_writer_init(void);
+void switcher_writer_free(void);
+void switcher_writer_queue(const char *path, const char *content);
+bool switcher_writer_pending(const char *path);
+long switcher_writer_written(void);
+long switcher_writer_coalesced(void);
@@ -1,61 +1,27 @@
 #include <obs-module.h>
-#include "source-switcher.h"
+#include "source-switcher-core.h"
+#include "source-switcher-watch.h"
+#include "source-switcher-writer.h"
 #include "version.h"
 #include "util/platform.h"
 #include <obs-frontend-api.h>
 
-struct switcher_hotkey_info {
-	obs_hotkey_id hotkey_id;
-	obs_source_t *source;
-};
-
-struct switcher_info {
-	obs_source_t *source;
-	obs_source_t *current_source;
-	DARRAY(obs_source_t *) sources;
-	DARRAY(struct switcher_hotkey_info) hotkeys;
-	size_t current_index;
-	bool loop;
-	uint64_t last_switch_time;
-	bool log;
-
-	bool time_switch;
-	uint64_t time_switch_duration;
-	uint64_t time_switch_between;
-	int32_t time_switch_to;
-
-	bool media_state_switch;
-	int32_t media_switch_state;
-	int32_t media_state_switch_to;
-
-	obs_source_t *transition;
-	obs_source_t *hide_transition;
-	obs_source_t *show_transition;
-	obs_source_t *current_transition;
-	int transition_running;
-	bool transition_resize;
-	uint64_t transition_duration;
-	bool current_source_file;
-	char *current_source_file_path;
-	uint64_t current_source_file_interval;
-	float current_source_file_duration;
-
-	enum obs_media_state state;
-};
-
 static const char *switcher_get_name(void *type_data)
 {
 	UNUSED_PARAMETER(type_data);
 	return obs_module_text("SourceSwitcher");
 }
 
-void switcher_source_rename(void *data, calldata_t *call_data)
+static const char *switcher_audio_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return obs_module_text("AudioSourceSwitcher");
+}
+
+static void switcher_rename_settings(struct switcher_info *switcher, const char *prev_name, const char *new_name)
 {
-	struct switcher_info *switcher = data;
-	const char *new_name = calldata_string(call_data, "new_name");
-	const char *prev_name = calldata_string(call_data, "prev_name");
 	obs_data_t *settings = obs_source_get_settings(switcher->source);
-	if (!settings || !new_name || !prev_name)
+	if (!settings)
 		return;
 	obs_data_array_t *sources = obs_data_get_array(settings, S_SOURCES);
 	if (sources) {
@@ -73,175 +39,33 @@ void switcher_source_rename(void *data, calldata_t *call_data)
 	obs_data_release(settings);
 }
 
-void switcher_index_changed(struct switcher_info *switcher)
+static void switcher_source_rename(void *data, calldata_t *call_data)
 {
-	if (!switcher->sources.num)
-		return;
+	UNUSED_PARAMETER(data);
+	const char *new_name = calldata_string(call_data, "new_name");
+	const char *prev_name = calldata_string(call_data, "prev_name");
+	switcher_registry_rename(prev_name, new_name, switcher_rename_settings);
+}
 
-	if (switcher->current_index >= switcher->sources.num) {
-		switcher->current_index = switcher->loop ? 0 : switcher->sources.num - 1;
-	}
-	obs_source_t *dest = switcher->sources.array[switcher->current_index];
-	if (switcher->current_source == dest)
+static void switcher_shuffle_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	if (!switcher->sources.num)
 		return;
-
-	if (!switcher->current_source && switcher->show_transition) {
-		if (!switcher->transition_resize) {
-			uint32_t cx = obs_source_get_width(dest);
-			uint32_t cy = obs_source_get_height(dest);
-			if (switcher->current_source) {
-				const uint32_t cxa = obs_source_get_width(switcher->current_source);
-				if (cxa > cx)
-					cx = cxa;
-				const uint32_t cya = obs_source_get_height(switcher->current_source);
-				if (cya > cy)
-					cy = cya;
-			}
-			obs_transition_set_size(switcher->show_transition, cx, cy);
-		} else {
-			obs_transition_set_size(switcher->show_transition, obs_source_get_width(switcher->current_source),
-						obs_source_get_height(switcher->current_source));
-		}
-		obs_transition_set(switcher->show_transition, switcher->current_source);
-		obs_transition_start(switcher->show_transition, OBS_TRANSITION_MODE_AUTO, (uint32_t)switcher->transition_duration,
-				     dest);
-		obs_source_add_active_child(switcher->source, switcher->show_transition);
-		switcher->transition_running = TRANSITION_SHOW;
-		uint32_t cx;
-		uint32_t cy;
-		obs_transition_get_size(switcher->show_transition, &cx, &cy);
-		if (switcher->log)
-			blog(LOG_INFO, "[source-switcher: '%s'] show transition to '%s' using '%s' for %i ms, %s {%i,%i}",
-			     obs_source_get_name(switcher->source), obs_source_get_name(dest),
-			     obs_source_get_name(switcher->show_transition), (int)switcher->transition_duration,
-			     switcher->transition_resize ? "resize" : "fixed size", cx, cy);
-		obs_source_release(switcher->current_transition);
-		switcher->current_transition = obs_source_get_ref(switcher->show_transition);
-	} else if (switcher->transition) {
-		if (!switcher->transition_resize) {
-			uint32_t cx = obs_source_get_width(dest);
-			uint32_t cy = obs_source_get_height(dest);
-			if (switcher->current_source) {
-				const uint32_t cxa = obs_source_get_width(switcher->current_source);
-				if (cxa > cx)
-					cx = cxa;
-				const uint32_t cya = obs_source_get_height(switcher->current_source);
-				if (cya > cy)
-					cy = cya;
-			}
-			obs_transition_set_size(switcher->transition, cx, cy);
-		} else {
-			obs_transition_set_size(switcher->transition, obs_source_get_width(switcher->current_source),
-						obs_source_get_height(switcher->current_source));
-		}
-		obs_transition_set(switcher->transition, switcher->current_source);
-		obs_transition_start(switcher->transition, OBS_TRANSITION_MODE_AUTO, (uint32_t)switcher->transition_duration, dest);
-		obs_source_add_active_child(switcher->source, switcher->transition);
-		switcher->transition_running = TRANSITION_NORMAL;
-		uint32_t cx;
-		uint32_t cy;
-		obs_transition_get_size(switcher->transition, &cx, &cy);
-		if (switcher->log)
-			blog(LOG_INFO, "[source-switcher: '%s'] transition to '%s' using '%s' for %i ms, %s {%i,%i}",
-			     obs_source_get_name(switcher->source), obs_source_get_name(dest),
-			     obs_source_get_name(switcher->transition), (int)switcher->transition_duration,
-			     switcher->transition_resize ? "resize" : "fixed size", cx, cy);
-		obs_source_release(switcher->current_transition);
-		switcher->current_transition = obs_source_get_ref(switcher->transition);
-	} else {
-		obs_source_release(switcher->current_transition);
-		switcher->current_transition = NULL;
-		if (switcher->log)
-			blog(LOG_INFO, "[source-switcher: '%s'] switch to '%s'", obs_source_get_name(switcher->source),
-			     obs_source_get_name(dest));
-	}
-	if (switcher->current_source) {
-		obs_source_release(switcher->current_source);
-		obs_source_remove_active_child(switcher->source, switcher->current_source);
-	}
-	switcher->current_source = obs_source_get_ref(dest);
-	obs_source_add_active_child(switcher->source, switcher->current_source);
-	if (switcher->current_source_file && switcher->current_source_file_path && strlen(switcher->current_source_file_path)) {
-		const char *source_name = switcher->current_source ? obs_source_get_name(switcher->current_source) : "";
-		os_quick_write_utf8_file(switcher->current_source_file_path, source_name, strlen(source_name), false);
-	}
+	switcher->switch_origin = command->origin;
+	switcher->switch_posted = command->posted;
+	switcher_shuffle(switcher);
 }
 
-void switcher_switch_to(struct switcher_info *switcher, int32_t switch_to)
-{
-	switcher->last_switch_time = obs_get_video_frame_time();
-	if (switch_to == SWITCH_NONE) {
-		if (switcher->current_source) {
-			obs_source_release(switcher->current_source);
-			obs_source_remove_active_child(switcher->source, switcher->current_source);
-			if (switcher->hide_transition) {
-				obs_transition_set_size(switcher->hide_transition, obs_source_get_width(switcher->current_source),
-							obs_source_get_height(switcher->current_source));
-				obs_transition_set(switcher->hide_transition, switcher->current_source);
-				obs_transition_start(switcher->hide_transition, OBS_TRANSITION_MODE_AUTO,
-						     (uint32_t)switcher->transition_duration, NULL);
-				obs_source_add_active_child(switcher->source, switcher->hide_transition);
-				switcher->transition_running = TRANSITION_HIDE;
-				if (switcher->log)
-					blog(LOG_INFO, "[source-switcher: '%s'] hide transition to none",
-					     obs_source_get_name(switcher->source));
-				obs_source_release(switcher->current_transition);
-				switcher->current_transition = obs_source_get_ref(switcher->hide_transition);
-			} else if (switcher->transition) {
-				obs_transition_set_size(switcher->transition, obs_source_get_width(switcher->current_source),
-							obs_source_get_height(switcher->current_source));
-				obs_transition_set(switcher->transition, switcher->current_source);
-				obs_transition_start(switcher->transition, OBS_TRANSITION_MODE_AUTO,
-						     (uint32_t)switcher->transition_duration, NULL);
-				obs_source_add_active_child(switcher->source, switcher->transition);
-				switcher->transition_running = TRANSITION_NORMAL;
-				if (switcher->log)
-					blog(LOG_INFO, "[source-switcher: '%s'] transition to none",
-					     obs_source_get_name(switcher->source));
-				obs_source_release(switcher->current_transition);
-				switcher->current_transition = obs_source_get_ref(switcher->transition);
-			} else {
-				obs_source_release(switcher->current_transition);
-				switcher->current_transition = NULL;
-				if (switcher->log)
-					blog(LOG_INFO, "[source-switcher: '%s'] switch to none",
-					     obs_source_get_name(switcher->source));
-			}
-			switcher->current_source = NULL;
-		}
-		return;
-	}
-	if (switch_to == SWITCH_NEXT) {
-		switcher->current_index++;
-	} else if (switch_to == SWITCH_PREVIOUS) {
-		if (!switcher->current_index) {
-			if (switcher->loop && switcher->sources.num) {
-				switcher->current_index = switcher->sources.num - 1;
-			}
-		} else {
-			switcher->current_index--;
-		}
-	} else if (switch_to == SWITCH_RANDOM) {
-		if (switcher->sources.num <= 1) {
-			switcher->current_index = 0;
-		} else {
-			if (switcher->current_index < switcher->sources.num) {
-				const size_t r = (size_t)rand() % (switcher->sources.num - 1);
-				if (r < switcher->current_index)
-					switcher->current_index = r;
-				else
-					switcher->current_index = r + 1;
-			} else {
-				switcher->current_index = (size_t)rand() % switcher->sources.num;
-			}
-		}
-	} else if (switch_to == SWITCH_FIRST) {
-		switcher->current_index = 0;
-	} else if (switch_to == SWITCH_LAST) {
-		if (switcher->sources.num)
-			switcher->current_index = switcher->sources.num - 1;
-	}
-	switcher_index_changed(switcher);
+static void switcher_post_switch(struct switcher_info *switcher, enum switcher_origin origin, int32_t switch_to)
+{
+	struct switcher_command command = {
+		.proc = switcher_switch_command,
+		.coalesce = true,
+		.origin = origin,
+		.switch_to = switch_to,
+		.index = -1,
+	};
+	switcher_post_command(switcher, &command);
 }
 
 void switcher_none_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -249,10 +73,8 @@ void switcher_none_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bo
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed)
-		return;
-	switcher_switch_to(switcher, SWITCH_NONE);
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_NONE);
 }
 
 void switcher_next_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -260,10 +82,8 @@ void switcher_next_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bo
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed)
-		return;
-	switcher_switch_to(switcher, SWITCH_NEXT);
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_NEXT);
 }
 
 void switcher_previous_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -271,10 +91,8 @@ void switcher_previous_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed)
-		return;
-	switcher_switch_to(switcher, SWITCH_PREVIOUS);
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_PREVIOUS);
 }
 
 void switcher_random_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -282,10 +100,8 @@ void switcher_random_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey,
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed || !switcher->sources.num)
-		return;
-	switcher_switch_to(switcher, SWITCH_RANDOM);
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_RANDOM);
 }
 
 void switcher_shuffle_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -293,24 +109,13 @@ void switcher_shuffle_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey,
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed || !switcher->sources.num)
-		return;
-	obs_data_t *settings = obs_source_get_settings(switcher->source);
-	if (!settings)
+	if (!pressed)
 		return;
-	obs_data_array_t *sources = obs_data_get_array(settings, S_SOURCES);
-	if (sources) {
-		const size_t count = obs_data_array_count(sources);
-		for (size_t i = 0; i < count; i++) {
-			obs_data_t *item = obs_data_array_item(sources, i);
-			obs_data_array_erase(sources, i);
-			obs_data_array_insert(sources, (size_t)rand() % count, item);
-			obs_data_release(item);
-		}
-	}
-	obs_source_update(switcher->source, settings);
-	obs_data_release(settings);
+	struct switcher_command command = {
+		.proc = switcher_shuffle_command,
+		.origin = SWITCHER_ORIGIN_HOTKEY,
+	};
+	switcher_post_command(data, &command);
 }
 
 void switcher_first_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -318,10 +123,8 @@ void switcher_first_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, b
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed)
-		return;
-	switcher_switch_to(switcher, SWITCH_FIRST);
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_FIRST);
 }
 
 void switcher_last_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -329,32 +132,8 @@ void switcher_last_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bo
 	UNUSED_PARAMETER(id);
 	UNUSED_PARAMETER(hotkey);
 
-	struct switcher_info *switcher = data;
-	if (!pressed)
-		return;
-	switcher_switch_to(switcher, SWITCH_LAST);
-}
-
-void switcher_switch_source_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
-{
-	UNUSED_PARAMETER(hotkey);
-	if (!pressed)
-		return;
-	struct switcher_info *switcher = data;
-	obs_source_t *source = NULL;
-	for (size_t i = 0; i < switcher->hotkeys.num; i++) {
-		if (switcher->hotkeys.array[i].hotkey_id == id)
-			source = switcher->hotkeys.array[i].source;
-	}
-	if (!source)
-		return;
-	for (size_t i = 0; i < switcher->sources.num; i++) {
-		if (switcher->sources.array[i] == source) {
-			switcher->current_index = i;
-			switcher_index_changed(switcher);
-			break;
-		}
-	}
+	if (pressed)
+		switcher_post_switch(data, SWITCHER_ORIGIN_HOTKEY, SWITCH_LAST);
 }
 
 static void switcher_update(void *data, obs_data_t *settings)
@@ -362,73 +141,65 @@ static void switcher_update(void *data, obs_data_t *settings)
 	struct switcher_info *switcher = data;
 	switcher->log = obs_data_get_bool(settings, S_LOG);
 	switcher->loop = obs_data_get_bool(settings, S_LOOP);
+	switcher->lookahead = (size_t)obs_data_get_int(settings, S_LOOKAHEAD);
+	const long long random_seed = obs_data_get_int(settings, S_RANDOM_SEED);
+	if (random_seed != switcher->random_seed)
+		switcher_random_seed(switcher, random_seed);
+	switcher->warm_pool_size = (size_t)obs_data_get_int(settings, S_WARM_POOL);
+	switcher->warm_pool_budget = (uint64_t)obs_data_get_int(settings, S_WARM_POOL_BUDGET) * 1024 * 1024;
+	switcher->latency_log_interval = (uint64_t)obs_data_get_int(settings, S_LATENCY_LOG_INTERVAL);
+	switcher->render_cache = !switcher->audio_only && obs_data_get_bool(settings, S_RENDER_CACHE);
+	const size_t hotkey_limit = (size_t)obs_data_get_int(settings, S_HOTKEY_LIMIT);
+	if (hotkey_limit != switcher->hotkey_limit) {
+		switcher->hotkey_limit = hotkey_limit;
+		switcher->hotkeys_dirty = true;
+	}
+	if (!switcher->render_cache && switcher->render_cache_texrender) {
+		obs_enter_graphics();
+		switcher_render_cache_free(switcher);
+		obs_leave_graphics();
+	}
 	switcher->current_source_file = obs_data_get_bool(settings, S_CURRENT_SOURCE_FILE);
 	if (switcher->current_source_file) {
 		bfree(switcher->current_source_file_path);
 		switcher->current_source_file_path = bstrdup(obs_data_get_string(settings, S_CURRENT_SOURCE_FILE_PATH));
 		switcher->current_source_file_interval = obs_data_get_int(settings, S_CURRENT_SOURCE_FILE_INTERVAL);
+		switcher->current_source_file_watch = obs_data_get_bool(settings, S_CURRENT_SOURCE_FILE_WATCH);
 	}
+	if (switcher->current_source_file && switcher->current_source_file_watch)
+		switcher_watch_add(switcher, switcher->current_source_file_path);
+	else
+		switcher_watch_remove(switcher);
 	obs_data_array_t *sources = obs_data_get_array(settings, S_SOURCES);
 	if (sources) {
-		for (size_t i = 0; i < switcher->sources.num; i++) {
-			obs_source_release(switcher->sources.array[i]);
-		}
-		switcher->sources.num = 0;
 		const size_t count = obs_data_array_count(sources);
+		DARRAY(const char *) names;
+		da_init(names);
+		da_reserve(names, count);
+		DARRAY(struct switcher_entry) entries;
+		da_init(entries);
+		da_reserve(entries, count);
 		for (size_t i = 0; i < count; i++) {
 			obs_data_t *item = obs_data_array_item(sources, i);
 			const char *source_name = obs_data_get_string(item, "value");
-			obs_source_t *source = obs_get_source_by_name(source_name);
-			if (source) {
-				da_push_back(switcher->sources, &source);
-				bool found = false;
-				for (size_t j = 0; !found && j < switcher->hotkeys.num; j++) {
-					if (source == switcher->hotkeys.array[j].source)
-						found = true;
-				}
-				if (!found) {
-					struct switcher_hotkey_info h;
-					h.source = source;
-					h.hotkey_id = obs_hotkey_register_source(switcher->source, obs_source_get_name(source),
-										 obs_source_get_name(source),
-										 switcher_switch_source_hotkey, switcher);
-					da_push_back(switcher->hotkeys, &h);
-				}
+			/* optional duration in ms, random weight and hotkey per entry, settable through the api */
+			struct switcher_entry entry = {0, 0, 1.0, false};
+			const long long duration = obs_data_get_int(item, "duration");
+			if (duration > 0)
+				entry.duration = (uint64_t)duration;
+			if (obs_data_has_user_value(item, "weight")) {
+				entry.weight = obs_data_get_double(item, "weight");
+				if (entry.weight < 0.0)
+					entry.weight = 0.0;
 			}
+			entry.hotkey = obs_data_get_bool(item, "hotkey");
+			da_push_back(names, &source_name);
+			da_push_back(entries, &entry);
 			obs_data_release(item);
 		}
-		size_t i = 0;
-		while (i < switcher->hotkeys.num) {
-			bool found = false;
-			for (size_t j = 0; !found && j < switcher->sources.num; j++) {
-				if (switcher->sources.array[j] == switcher->hotkeys.array[i].source)
-					found = true;
-			}
-			if (found) {
-				i++;
-			} else {
-				obs_hotkey_unregister(switcher->hotkeys.array[i].hotkey_id);
-				da_erase(switcher->hotkeys, i);
-			}
-		}
-		if (!switcher->sources.num) {
-			switcher->current_index = 0;
-			if (switcher->current_source) {
-				obs_source_release(switcher->current_source);
-				obs_source_remove_active_child(switcher->source, switcher->current_source);
-				switcher->current_source = NULL;
-			}
-		} else {
-			if (switcher->current_source) {
-				for (size_t i = 0; i < switcher->sources.num; i++) {
-					if (switcher->current_source == switcher->sources.array[i]) {
-						switcher->current_index = i;
-						break;
-					}
-				}
-			}
-			switcher_index_changed(switcher);
-		}
+		switcher_update_sources(switcher, names.array, entries.array, names.num);
+		da_free(names);
+		da_free(entries);
 		obs_data_array_release(sources);
 	}
 
@@ -436,12 +207,16 @@ static void switcher_update(void *data, obs_data_t *settings)
 	switcher->time_switch_duration = obs_data_get_int(settings, S_TIME_SWITCH_DURATION);
 	switcher->time_switch_between = obs_data_get_int(settings, S_TIME_SWITCH_BETWEEN);
 	switcher->time_switch_to = (int32_t)obs_data_get_int(settings, S_TIME_SWITCH_TO);
+	switcher->use_media_duration = obs_data_get_bool(settings, S_USE_MEDIA_DURATION);
+	/* entry lengths depend on the durations above */
+	switcher->timeline_dirty = true;
 
 	switcher->media_state_switch = obs_data_get_bool(settings, S_MEDIA_STATE_SWITCH);
 	switcher->media_switch_state = (int32_t)obs_data_get_int(settings, S_MEDIA_SWITCH_STATE);
 	switcher->media_state_switch_to = (int32_t)obs_data_get_int(settings, S_MEDIA_STATE_SWITCH_TO);
 
-	const char *transition_id = obs_data_get_string(settings, S_TRANSITION);
+	/* audio only switchers crossfade themselves and never use transitions */
+	const char *transition_id = switcher->audio_only ? NULL : obs_data_get_string(settings, S_TRANSITION);
 	if (!transition_id || !strlen(transition_id)) {
 		obs_source_t *old_transition = switcher->transition;
 		switcher->transition = NULL;
@@ -463,7 +238,7 @@ static void switcher_update(void *data, obs_data_t *settings)
 		obs_transition_set_scale_type(switcher->transition,
 					      (enum obs_transition_scale_type)obs_data_get_int(settings, S_TRANSITION_SCALE));
 	}
-	const char *show_transition_id = obs_data_get_string(settings, S_SHOW_TRANSITION);
+	const char *show_transition_id = switcher->audio_only ? NULL : obs_data_get_string(settings, S_SHOW_TRANSITION);
 	if (!show_transition_id || !strlen(show_transition_id)) {
 		obs_source_release(switcher->show_transition);
 		switcher->show_transition = NULL;
@@ -480,7 +255,7 @@ static void switcher_update(void *data, obs_data_t *settings)
 		obs_transition_set_scale_type(switcher->show_transition,
 					      (enum obs_transition_scale_type)obs_data_get_int(settings, S_TRANSITION_SCALE));
 	}
-	const char *hide_transition_id = obs_data_get_string(settings, S_HIDE_TRANSITION);
+	const char *hide_transition_id = switcher->audio_only ? NULL : obs_data_get_string(settings, S_HIDE_TRANSITION);
 	if (!hide_transition_id || !strlen(hide_transition_id)) {
 		obs_source_release(switcher->hide_transition);
 		switcher->hide_transition = NULL;
@@ -503,31 +278,186 @@ static void switcher_update(void *data, obs_data_t *settings)
 	if (switcher->current_source_file && switcher->current_source_file_path && strlen(switcher->current_source_file_path) &&
 	    !os_file_exists(switcher->current_source_file_path)) {
 		const char *source_name = switcher->current_source ? obs_source_get_name(switcher->current_source) : "";
-		os_quick_write_utf8_file(switcher->current_source_file_path, source_name, strlen(source_name), false);
+		switcher_writer_queue(switcher->current_source_file_path, source_name);
 	}
+	switcher_warm_pool_trim(switcher);
+	/* the schedule settings above decide which sources are next */
+	switcher_lookahead_refresh(switcher);
 }
 
 static void current_slide_proc(void *data, calldata_t *cd)
 {
-	struct switcher_info *switcher = data;
-	calldata_set_int(cd, "current_index", switcher->current_index);
+	struct switcher_state_snapshot state;
+	switcher_state_get(data, &state);
+	calldata_set_int(cd, "current_index", (long long)state.current_index);
+	obs_source_release(state.current_transition);
+	obs_source_release(state.current_source);
 }
 
 static void total_slides_proc(void *data, calldata_t *cd)
+{
+	struct switcher_state_snapshot state;
+	switcher_state_get(data, &state);
+	calldata_set_int(cd, "total_files", (long long)state.total_sources);
+	obs_source_release(state.current_transition);
+	obs_source_release(state.current_source);
+}
+
+static void switch_latency_proc(void *data, calldata_t *cd)
 {
 	struct switcher_info *switcher = data;
-	calldata_set_int(cd, "total_files", switcher->sources.num);
+	struct switcher_latency_summary first_frame;
+	struct switcher_latency_summary transition;
+	switcher_latency_summary(switcher, &first_frame, &transition);
+	calldata_set_int(cd, "switches", (long long)first_frame.count);
+	calldata_set_float(cd, "first_frame_min", first_frame.min_ms);
+	calldata_set_float(cd, "first_frame_avg", first_frame.avg_ms);
+	calldata_set_float(cd, "first_frame_p99", first_frame.p99_ms);
+	calldata_set_float(cd, "first_frame_max", first_frame.max_ms);
+	calldata_set_int(cd, "transitions", (long long)transition.count);
+	calldata_set_float(cd, "transition_min", transition.min_ms);
+	calldata_set_float(cd, "transition_avg", transition.avg_ms);
+	calldata_set_float(cd, "transition_p99", transition.p99_ms);
+	calldata_set_float(cd, "transition_max", transition.max_ms);
+	struct switcher_state_snapshot state;
+	switcher_state_get(switcher, &state);
+	calldata_set_string(cd, "last_origin", switcher_origin_name(state.last_origin));
+	calldata_set_int(cd, "time_switch_slips", (long long)state.time_switch_slips);
+	calldata_set_int(cd, "coalesced", (long long)state.switches_coalesced);
+	calldata_set_float(cd, "time_switch_max_slip", (double)state.time_switch_max_slip / 1000000.0);
+	obs_source_release(state.current_transition);
+	obs_source_release(state.current_source);
 }
 
-static void *switcher_create(obs_data_t *settings, obs_source_t *source)
+/* Transition for a single proc switch: empty keeps the configured transitions, "cut" switches
+ * without one and anything else is a transition type id, kept around for the next call. */
+static void switcher_proc_transition(struct switcher_info *switcher, const char *id)
+{
+	if (!id || !*id)
+		return;
+	if (strcmp(id, "cut") == 0) {
+		switcher->transition_override = NULL;
+		switcher->transition_override_set = true;
+		return;
+	}
+	if (!switcher->proc_transition || strcmp(obs_source_get_id(switcher->proc_transition), id) != 0) {
+		obs_source_t *transition = obs_source_create_private(id, obs_module_text("Transition"), NULL);
+		if (!transition || obs_source_get_type(transition) != OBS_SOURCE_TYPE_TRANSITION) {
+			blog(LOG_WARNING, "[source-switcher: '%s'] '%s' is not a transition", obs_source_get_name(switcher->source),
+			     id);
+			obs_source_release(transition);
+			return;
+		}
+		obs_source_release(switcher->proc_transition);
+		switcher->proc_transition = transition;
+	}
+	switcher->transition_override = switcher->proc_transition;
+	switcher->transition_override_set = true;
+}
+
+static void switcher_proc_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	switcher_proc_transition(switcher, command->transition);
+	switcher_switch_command(switcher, command);
+	switcher->transition_override_set = false;
+}
+
+/* Proc switches are run by the next video tick, queued only tells the caller the switch was accepted.
+ * The switch_started signal reports the switch once it happened. */
+static void switcher_proc_switch(struct switcher_info *switcher, calldata_t *cd, int32_t switch_to, long long index,
+				 const char *name)
+{
+	const char *transition = calldata_string(cd, "transition");
+	struct switcher_command command = {
+		.proc = switcher_proc_command,
+		.coalesce = true,
+		.origin = SWITCHER_ORIGIN_PROC,
+		.switch_to = switch_to,
+		.index = index,
+		.name = name ? bstrdup(name) : NULL,
+		.transition = transition && *transition ? bstrdup(transition) : NULL,
+	};
+	calldata_set_bool(cd, "queued", switcher_post_command(switcher, &command));
+}
+
+static void switch_next_proc(void *data, calldata_t *cd)
+{
+	switcher_proc_switch(data, cd, SWITCH_NEXT, -1, NULL);
+}
+
+static void switch_previous_proc(void *data, calldata_t *cd)
+{
+	switcher_proc_switch(data, cd, SWITCH_PREVIOUS, -1, NULL);
+}
+
+static void switch_random_proc(void *data, calldata_t *cd)
+{
+	switcher_proc_switch(data, cd, SWITCH_RANDOM, -1, NULL);
+}
+
+static void switch_none_proc(void *data, calldata_t *cd)
+{
+	switcher_proc_switch(data, cd, SWITCH_NONE, -1, NULL);
+}
+
+static void switch_to_index_proc(void *data, calldata_t *cd)
+{
+	const long long index = calldata_int(cd, "index");
+	if (index < 0) {
+		calldata_set_bool(cd, "queued", false);
+		return;
+	}
+	switcher_proc_switch(data, cd, SWITCH_NONE, index, NULL);
+}
+
+static void switch_to_name_proc(void *data, calldata_t *cd)
+{
+	const char *name = calldata_string(cd, "name");
+	if (!name || !*name) {
+		calldata_set_bool(cd, "queued", false);
+		return;
+	}
+	switcher_proc_switch(data, cd, SWITCH_NONE, -1, name);
+}
+
+/* everything a controller needs in one call */
+static void get_state_proc(void *data, calldata_t *cd)
+{
+	struct switcher_state_snapshot state;
+	switcher_state_get(data, &state);
+	const char *transition = state.transition_running == TRANSITION_NORMAL ? "normal"
+				 : state.transition_running == TRANSITION_SHOW ? "show"
+				 : state.transition_running == TRANSITION_HIDE ? "hide"
+										: "none";
+	calldata_set_int(cd, "current_index", (long long)state.current_index);
+	calldata_set_string(cd, "current_source", state.current_source ? obs_source_get_name(state.current_source) : "");
+	calldata_set_int(cd, "total_sources", (long long)state.total_sources);
+	calldata_set_string(cd, "transition", transition);
+	calldata_set_float(cd, "transition_time",
+			   state.current_transition ? obs_transition_get_time(state.current_transition) : 1.0);
+	calldata_set_int(cd, "time", state.time);
+	calldata_set_int(cd, "duration", state.duration);
+	calldata_set_bool(cd, "playing", state.playing);
+	obs_source_release(state.current_transition);
+	obs_source_release(state.current_source);
+}
+
+static void render_cache_proc(void *data, calldata_t *cd)
+{
+	struct switcher_state_snapshot state;
+	switcher_state_get(data, &state);
+	calldata_set_int(cd, "hits", (long long)state.render_cache_hits);
+	calldata_set_int(cd, "misses", (long long)state.render_cache_misses);
+	obs_source_release(state.current_transition);
+	obs_source_release(state.current_source);
+}
+
+static struct switcher_info *switcher_create_internal(obs_data_t *settings, obs_source_t *source, bool audio_only)
 {
-	UNUSED_PARAMETER(settings);
 	struct switcher_info *switcher = bzalloc(sizeof(struct switcher_info));
 	proc_handler_t *ph = obs_source_get_proc_handler(source);
-	switcher->source = source;
-	switcher->state = OBS_MEDIA_STATE_PLAYING;
-	da_init(switcher->sources);
-	da_init(switcher->hotkeys);
+	switcher_init(switcher, source);
+	switcher->audio_only = audio_only;
 	obs_hotkey_register_source(source, "none", obs_module_text("None"), switcher_none_hotkey, switcher);
 	obs_hotkey_register_source(source, "next", obs_module_text("Next"), switcher_next_hotkey, switcher);
 	obs_hotkey_register_source(source, "previous", obs_module_text("Previous"), switcher_previous_hotkey, switcher);
@@ -535,156 +465,143 @@ static void *switcher_create(obs_data_t *settings, obs_source_t *source)
 	obs_hotkey_register_source(source, "shuffle", obs_module_text("Shuffle"), switcher_shuffle_hotkey, switcher);
 	obs_hotkey_register_source(source, "first", obs_module_text("First"), switcher_first_hotkey, switcher);
 	obs_hotkey_register_source(source, "last", obs_module_text("Last"), switcher_last_hotkey, switcher);
-	signal_handler_connect(obs_get_signal_handler(), "source_rename", switcher_source_rename, switcher);
 	proc_handler_add(ph, "void current_index(out int current_index)", current_slide_proc, switcher);
 	proc_handler_add(ph, "void total_files(out int total_files)", total_slides_proc, switcher);
+	proc_handler_add(ph,
+			 "void switch_latency(out int switches, out float first_frame_min, out float first_frame_avg, "
+			 "out float first_frame_p99, out float first_frame_max, out int transitions, out float transition_min, "
+			 "out float transition_avg, out float transition_p99, out float transition_max, out string last_origin, "
+			 "out int time_switch_slips, out float time_switch_max_slip, out int coalesced)",
+			 switch_latency_proc, switcher);
+	proc_handler_add(ph, "void render_cache(out int hits, out int misses)", render_cache_proc, switcher);
+	proc_handler_add(ph, "void switch_to_index(in int index, in string transition, out bool queued)", switch_to_index_proc,
+			 switcher);
+	proc_handler_add(ph, "void switch_to_name(in string name, in string transition, out bool queued)", switch_to_name_proc,
+			 switcher);
+	proc_handler_add(ph, "void switch_next(in string transition, out bool queued)", switch_next_proc, switcher);
+	proc_handler_add(ph, "void switch_previous(in string transition, out bool queued)", switch_previous_proc, switcher);
+	proc_handler_add(ph, "void switch_random(in string transition, out bool queued)", switch_random_proc, switcher);
+	proc_handler_add(ph, "void switch_none(in string transition, out bool queued)", switch_none_proc, switcher);
+	proc_handler_add(ph,
+			 "void get_state(out int current_index, out string current_source, out int total_sources, "
+			 "out string transition, out float transition_time, out int time, out int duration, out bool playing)",
+			 get_state_proc, switcher);
 
 	switcher_update(switcher, settings);
 	return switcher;
 }
 
+static void *switcher_create(obs_data_t *settings, obs_source_t *source)
+{
+	return switcher_create_internal(settings, source, false);
+}
+
+static void *switcher_audio_create(obs_data_t *settings, obs_source_t *source)
+{
+	return switcher_create_internal(settings, source, true);
+}
+
 static void switcher_destroy(void *data)
 {
 	struct switcher_info *switcher = data;
-	signal_handler_disconnect(obs_get_signal_handler(), "source_rename", switcher_source_rename, switcher);
-	if (switcher->current_source) {
-		obs_source_release(switcher->current_source);
-		obs_source_remove_active_child(switcher->source, switcher->current_source);
-		switcher->current_source = NULL;
-	}
-	if (switcher->current_transition) {
-		obs_source_release(switcher->current_transition);
-		switcher->current_transition = NULL;
-	}
-	for (size_t i = 0; i < switcher->sources.num; i++) {
-		obs_source_release(switcher->sources.array[i]);
-	}
-	da_free(switcher->sources);
-	da_free(switcher->hotkeys);
+	switcher_watch_remove(switcher);
+	if (switcher->log && (switcher->render_cache_hits || switcher->render_cache_misses))
+		blog(LOG_INFO, "[source-switcher: '%s'] render cache: %llu hits, %llu misses",
+		     obs_source_get_name(switcher->source), (unsigned long long)switcher->render_cache_hits,
+		     (unsigned long long)switcher->render_cache_misses);
+	obs_enter_graphics();
+	switcher_render_cache_free(switcher);
+	obs_leave_graphics();
+	switcher_release(switcher);
 	obs_source_release(switcher->transition);
 	obs_source_release(switcher->show_transition);
 	obs_source_release(switcher->hide_transition);
+	obs_source_release(switcher->proc_transition);
 	bfree(switcher->current_source_file_path);
 	bfree(switcher);
 }
 
-bool switcher_transition_active(obs_source_t *transition)
+/* out += in * gain for the requested mixes and channels */
+static void switcher_audio_mix(struct obs_source_audio_mix *out, const struct obs_source_audio_mix *in, uint32_t mixers,
+			       size_t channels, const float *gain)
 {
-	if (!transition)
-		return false;
-	const float t = obs_transition_get_time(transition);
-	return t >= 0.0f && t < 1.0f;
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *dst = out->output[mix].data[ch];
+			const float *src = in->output[mix].data[ch];
+			for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++)
+				dst[i] += src[i] * gain[i];
+		}
+	}
 }
 
-static void switcher_video_render(void *data, gs_effect_t *effect)
+/* Audio only switchers mix the current source with the one fading out, the output
+ * buffers of the requested mixes are cleared by libobs before audio_render is called. */
+static bool switcher_audio_crossfade(struct switcher_info *switcher, uint64_t *ts_out, struct obs_source_audio_mix *audio_output,
+				     uint32_t mixers, size_t channels, size_t sample_rate)
 {
-	UNUSED_PARAMETER(effect);
-	struct switcher_info *switcher = data;
-	if (switcher_transition_active(switcher->current_transition)) {
-		if (switcher->transition_resize) {
-			obs_source_t *source_a = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_A);
-			obs_source_t *source_b = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_B);
-			uint32_t cxa = 0;
-			uint32_t cya = 0;
-			uint32_t cxb = 0;
-			uint32_t cyb = 0;
-			if (source_a) {
-				cxa = obs_source_get_width(source_a);
-				cya = obs_source_get_height(source_a);
-			}
-			if (source_b) {
-				cxb = obs_source_get_width(source_b);
-				cyb = obs_source_get_height(source_b);
-			}
-			const float t = obs_transition_get_time(switcher->current_transition);
-			const uint32_t cx = (cxa && cxb) ? (uint32_t)((1.0f - t) * (float)cxa + t * (float)cxb) : cxa + cxb;
-			const uint32_t cy = (cya && cyb) ? (uint32_t)((1.0f - t) * (float)cya + t * (float)cyb) : cya + cyb;
-			obs_source_release(source_a);
-			obs_source_release(source_b);
-			obs_transition_set_size(switcher->current_transition, cx, cy);
-		}
-		obs_source_video_render(switcher->current_transition);
-	} else {
-		if (switcher->transition && switcher->transition_running == TRANSITION_NORMAL) {
-			const uint64_t t = obs_get_video_frame_time();
-			if (t > switcher->last_switch_time &&
-			    t - switcher->last_switch_time > 10000000UL) { // wait 10 ms before start checking state
-				switcher->transition_running = TRANSITION_NONE;
-				obs_source_remove_active_child(switcher->source, switcher->transition);
-				obs_transition_force_stop(switcher->transition);
-				obs_transition_clear(switcher->transition);
-				if (switcher->current_source) {
-					obs_source_video_render(switcher->current_source);
-				}
-			} else {
-				obs_source_t *source = obs_transition_get_source(switcher->transition, OBS_TRANSITION_SOURCE_A);
-				if (source) {
-					obs_source_video_render(source);
-					obs_source_release(source);
-				} else {
-					obs_source_video_render(switcher->transition);
-				}
-			}
-		} else if (switcher->show_transition && switcher->transition_running == TRANSITION_SHOW) {
-			const uint64_t t = obs_get_video_frame_time();
-			if (t > switcher->last_switch_time &&
-			    t - switcher->last_switch_time > 10000000UL) { // wait 10 ms before start checking state
-				switcher->transition_running = TRANSITION_NONE;
-				obs_source_remove_active_child(switcher->source, switcher->show_transition);
-				obs_transition_force_stop(switcher->show_transition);
-				obs_transition_clear(switcher->show_transition);
-				if (switcher->current_source) {
-					obs_source_video_render(switcher->current_source);
-				}
-			} else {
-				obs_source_t *source =
-					obs_transition_get_source(switcher->show_transition, OBS_TRANSITION_SOURCE_A);
-				if (source) {
-					obs_source_video_render(source);
-					obs_source_release(source);
-				} else {
-					obs_source_video_render(switcher->show_transition);
-				}
-			}
-		} else if (switcher->hide_transition && switcher->transition_running == TRANSITION_SHOW) {
-			const uint64_t t = obs_get_video_frame_time();
-			if (t > switcher->last_switch_time &&
-			    t - switcher->last_switch_time > 10000000UL) { // wait 10 ms before start checking state
-				switcher->transition_running = TRANSITION_NONE;
-				obs_source_remove_active_child(switcher->source, switcher->hide_transition);
-				obs_transition_force_stop(switcher->hide_transition);
-				obs_transition_clear(switcher->hide_transition);
-				if (switcher->current_source) {
-					obs_source_video_render(switcher->current_source);
-				}
-			} else {
-				obs_source_t *source =
-					obs_transition_get_source(switcher->hide_transition, OBS_TRANSITION_SOURCE_A);
-				if (source) {
-					obs_source_video_render(source);
-					obs_source_release(source);
-				} else {
-					obs_source_video_render(switcher->hide_transition);
-				}
-			}
-		} else if (switcher->current_source) {
-			obs_source_video_render(switcher->current_source);
+	pthread_mutex_lock(&switcher->audio_fade_mutex);
+	obs_source_t *source = switcher->current_source;
+	obs_source_t *fade = switcher->audio_fade_source;
+	if (!source && !fade) {
+		pthread_mutex_unlock(&switcher->audio_fade_mutex);
+		return false;
+	}
+
+	const char *profile_name = switcher->profile_audio;
+	profile_start(profile_name);
+	uint64_t timestamp = 0;
+	float gain_in[AUDIO_OUTPUT_FRAMES];
+	float gain_out[AUDIO_OUTPUT_FRAMES];
+	const uint64_t fade_length = switcher->transition_duration * sample_rate / 1000;
+	for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++) {
+		const uint64_t pos = switcher->audio_fade_pos + i;
+		gain_in[i] = !fade || pos >= fade_length ? 1.0f : (float)pos / (float)fade_length;
+		gain_out[i] = 1.0f - gain_in[i];
+	}
+
+	struct obs_source_audio_mix child_audio;
+	if (source && !obs_source_audio_pending(source)) {
+		timestamp = obs_source_get_audio_timestamp(source);
+		obs_source_get_audio_mix(source, &child_audio);
+		switcher_audio_mix(audio_output, &child_audio, mixers, channels, gain_in);
+	}
+	if (fade) {
+		if (!obs_source_audio_pending(fade)) {
+			if (!timestamp)
+				timestamp = obs_source_get_audio_timestamp(fade);
+			obs_source_get_audio_mix(fade, &child_audio);
+			switcher_audio_mix(audio_output, &child_audio, mixers, channels, gain_out);
 		}
+		switcher->audio_fade_pos += AUDIO_OUTPUT_FRAMES;
+		if (switcher->audio_fade_pos >= fade_length)
+			os_atomic_set_bool(&switcher->audio_fade_done, true);
 	}
+	pthread_mutex_unlock(&switcher->audio_fade_mutex);
+	*ts_out = timestamp;
+	profile_end(profile_name);
+	return true;
 }
 
 static bool switcher_audio_render(void *data, uint64_t *ts_out, struct obs_source_audio_mix *audio_output, uint32_t mixers,
 				  size_t channels, size_t sample_rate)
 {
-	UNUSED_PARAMETER(mixers);
-	UNUSED_PARAMETER(channels);
-	UNUSED_PARAMETER(sample_rate);
 	struct switcher_info *switcher = data;
+	if (switcher->audio_only)
+		return switcher_audio_crossfade(switcher, ts_out, audio_output, mixers, channels, sample_rate);
 	obs_source_t *source = switcher_transition_active(switcher->current_transition) ? switcher->current_transition
 											: switcher->current_source;
 	if (!source)
 		return false;
+	/* nothing to pass on from sources without audio, like images */
+	if (source == switcher->current_source &&
+	    !(obs_source_get_output_flags(source) & (OBS_SOURCE_AUDIO | OBS_SOURCE_COMPOSITE)))
+		return false;
 
+	const char *profile_name = switcher->profile_audio;
+	profile_start(profile_name);
 	uint64_t timestamp = 0;
 
 	if (!obs_source_audio_pending(source)) {
@@ -693,9 +610,18 @@ static bool switcher_audio_render(void *data, uint64_t *ts_out, struct obs_sourc
 		struct obs_source_audio_mix child_audio;
 		obs_source_get_audio_mix(source, &child_audio);
 
-		memcpy(audio_output->output[0].data[0], child_audio.output[0].data[0], TOTAL_AUDIO_SIZE);
+		profile_start("audio_copy");
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			if ((mixers & (1 << mix)) == 0)
+				continue;
+			for (size_t ch = 0; ch < channels; ch++)
+				memcpy(audio_output->output[mix].data[ch], child_audio.output[mix].data[ch],
+				       AUDIO_OUTPUT_FRAMES * sizeof(float));
+		}
+		profile_end("audio_copy");
 	}
 	*ts_out = timestamp;
+	profile_end(profile_name);
 	return true;
 }
 
@@ -707,6 +633,7 @@ void prop_list_add_switch_to(obs_property_t *p)
 	obs_property_list_add_int(p, obs_module_text("First"), SWITCH_FIRST);
 	obs_property_list_add_int(p, obs_module_text("Last"), SWITCH_LAST);
 	obs_property_list_add_int(p, obs_module_text("Random"), SWITCH_RANDOM);
+	obs_property_list_add_int(p, obs_module_text("Shuffle"), SWITCH_SHUFFLE);
 }
 
 void prop_list_add_scales(obs_property_t *p)
@@ -726,90 +653,34 @@ bool remove_prop(obs_properties_t *props, const char *name)
 	return false;
 }
 
+/* the transitions of the switcher belong to the video thread, switcher_update replaces them there */
+static bool transition_id_fixed(const char *id)
+{
+	obs_source_t *transition = obs_source_create_private(id, NULL, NULL);
+	const bool fixed = obs_transition_fixed(transition);
+	obs_source_release(transition);
+	return fixed;
+}
+
 bool switcher_transition_changed(void *data, obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
 {
+	UNUSED_PARAMETER(data);
 	UNUSED_PARAMETER(property);
-	struct switcher_info *switcher = data;
 	const char *transition_id = obs_data_get_string(settings, S_TRANSITION);
 	const char *show_transition_id = obs_data_get_string(settings, S_SHOW_TRANSITION);
 	const char *hide_transition_id = obs_data_get_string(settings, S_HIDE_TRANSITION);
 	obs_properties_t *transition_group = obs_property_group_content(obs_properties_get(props, S_TRANSITION_GROUP));
 	if ((!transition_id || !strlen(transition_id)) && (!show_transition_id || !strlen(show_transition_id)) &&
 	    (!hide_transition_id || !strlen(hide_transition_id))) {
-		if (switcher->transition) {
-			obs_source_release(switcher->transition);
-			switcher->transition = NULL;
-		}
-		if (switcher->show_transition) {
-			obs_source_release(switcher->show_transition);
-			switcher->show_transition = NULL;
-		}
-		if (switcher->hide_transition) {
-			obs_source_release(switcher->hide_transition);
-			switcher->hide_transition = NULL;
-		}
 		remove_prop(transition_group, S_TRANSITION_DURATION);
 		remove_prop(transition_group, S_TRANSITION_SCALE);
 		remove_prop(transition_group, S_TRANSITION_RESIZE);
 		remove_prop(transition_group, S_TRANSITION_ALIGNMENT);
 		return true;
 	}
-	if (transition_id && strlen(transition_id)) {
-		if (!switcher->transition || strcmp(obs_source_get_id(switcher->transition), transition_id) != 0) {
-			obs_source_t *old_transition = switcher->transition;
-			obs_data_t *s = obs_data_get_obj(settings, S_TRANSITION_PROPERTIES);
-			switcher->transition = obs_source_create_private(transition_id, obs_module_text("Transition"), s);
-			obs_data_release(s);
-			obs_transition_set_alignment(switcher->transition,
-						     (uint32_t)obs_data_get_int(settings, S_TRANSITION_ALIGNMENT));
-			obs_transition_set_scale_type(switcher->transition, (enum obs_transition_scale_type)obs_data_get_int(
-										    settings, S_TRANSITION_SCALE));
-			obs_source_release(old_transition);
-		}
-	} else if (switcher->transition) {
-		obs_source_t *old_transition = switcher->transition;
-		switcher->transition = NULL;
-		obs_source_release(old_transition);
-	}
-	if (show_transition_id && strlen(show_transition_id)) {
-		if (!switcher->show_transition || strcmp(obs_source_get_id(switcher->show_transition), show_transition_id) != 0) {
-			obs_source_t *old_transition = switcher->show_transition;
-			obs_data_t *s = obs_data_get_obj(settings, S_SHOW_TRANSITION_PROPERTIES);
-			switcher->show_transition =
-				obs_source_create_private(show_transition_id, obs_module_text("ShowTransition"), s);
-			obs_data_release(s);
-			obs_transition_set_alignment(switcher->show_transition,
-						     (uint32_t)obs_data_get_int(settings, S_TRANSITION_ALIGNMENT));
-			obs_transition_set_scale_type(switcher->show_transition, (enum obs_transition_scale_type)obs_data_get_int(
-											 settings, S_TRANSITION_SCALE));
-			obs_source_release(old_transition);
-		}
-	} else if (switcher->show_transition) {
-		obs_source_t *old_transition = switcher->show_transition;
-		switcher->show_transition = NULL;
-		obs_source_release(old_transition);
-	}
-	if (hide_transition_id && strlen(hide_transition_id)) {
-		if (!switcher->hide_transition || strcmp(obs_source_get_id(switcher->hide_transition), hide_transition_id) != 0) {
-			obs_source_t *old_transition = switcher->hide_transition;
-			obs_data_t *s = obs_data_get_obj(settings, S_SHOW_TRANSITION_PROPERTIES);
-			switcher->hide_transition =
-				obs_source_create_private(hide_transition_id, obs_module_text("HideTransition"), s);
-			obs_data_release(s);
-			obs_transition_set_alignment(switcher->hide_transition,
-						     (uint32_t)obs_data_get_int(settings, S_TRANSITION_ALIGNMENT));
-			obs_transition_set_scale_type(switcher->hide_transition, (enum obs_transition_scale_type)obs_data_get_int(
-											 settings, S_TRANSITION_SCALE));
-			obs_source_release(old_transition);
-		}
-	} else if (switcher->hide_transition) {
-		obs_source_t *old_transition = switcher->hide_transition;
-		switcher->hide_transition = NULL;
-		obs_source_release(old_transition);
-	}
 
 	obs_property_t *p = obs_properties_get(transition_group, S_TRANSITION_DURATION);
-	if (obs_transition_fixed(switcher->transition)) {
+	if (transition_id && strlen(transition_id) && transition_id_fixed(transition_id)) {
 		remove_prop(transition_group, S_TRANSITION_DURATION);
 	} else if (!p) {
 		p = obs_properties_add_int(transition_group, S_TRANSITION_DURATION, obs_module_text("Duration"), 50, 10000, 100);
@@ -882,6 +753,8 @@ static bool open_hide_transition_properties(obs_properties_t *props, obs_propert
 	return false;
 }
 
+static obs_properties_t *switcher_properties_file(obs_properties_t *ppts);
+
 static obs_properties_t *switcher_properties(void *data)
 {
 	obs_property_t *p;
@@ -889,6 +762,20 @@ static obs_properties_t *switcher_properties(void *data)
 	obs_properties_add_editable_list(ppts, S_SOURCES, obs_module_text("Sources"), OBS_EDITABLE_LIST_TYPE_STRINGS, NULL, NULL);
 	obs_properties_add_bool(ppts, S_LOOP, obs_module_text("Loop"));
 	obs_properties_add_bool(ppts, S_LOG, obs_module_text("Log"));
+	p = obs_properties_add_int(ppts, S_LOOKAHEAD, obs_module_text("Lookahead"), 0, 10, 1);
+	obs_property_set_long_description(p, obs_module_text("LookaheadDescription"));
+	p = obs_properties_add_int(ppts, S_RANDOM_SEED, obs_module_text("RandomSeed"), 0, 2147483647, 1);
+	obs_property_set_long_description(p, obs_module_text("RandomSeedDescription"));
+	p = obs_properties_add_int(ppts, S_WARM_POOL, obs_module_text("WarmPool"), 0, 32, 1);
+	obs_property_set_long_description(p, obs_module_text("WarmPoolDescription"));
+	p = obs_properties_add_int(ppts, S_WARM_POOL_BUDGET, obs_module_text("WarmPoolBudget"), 0, 65536, 64);
+	obs_property_int_set_suffix(p, "MB");
+	obs_property_set_long_description(p, obs_module_text("WarmPoolBudgetDescription"));
+	p = obs_properties_add_int(ppts, S_LATENCY_LOG_INTERVAL, obs_module_text("LatencyLog"), 0, 3600, 10);
+	obs_property_int_set_suffix(p, "s");
+	obs_property_set_long_description(p, obs_module_text("LatencyLogDescription"));
+	p = obs_properties_add_int(ppts, S_HOTKEY_LIMIT, obs_module_text("HotkeyLimit"), 0, 1000000, 1);
+	obs_property_set_long_description(p, obs_module_text("HotkeyLimitDescription"));
 	obs_properties_t *tsppts = obs_properties_create();
 	p = obs_properties_add_int(tsppts, S_TIME_SWITCH_DURATION, obs_module_text("Duration"), 50, 1000000UL, 1000);
 	obs_property_int_set_suffix(p, "ms");
@@ -897,6 +784,8 @@ static obs_properties_t *switcher_properties(void *data)
 	p = obs_properties_add_list(tsppts, S_TIME_SWITCH_TO, obs_module_text("SwitchTo"), OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_INT);
 	prop_list_add_switch_to(p);
+	p = obs_properties_add_bool(tsppts, S_USE_MEDIA_DURATION, obs_module_text("UseMediaDuration"));
+	obs_property_set_long_description(p, obs_module_text("UseMediaDurationDescription"));
 	obs_properties_add_group(ppts, S_TIME_SWITCH, obs_module_text("TimeSwitch"), OBS_GROUP_CHECKABLE, tsppts);
 
 	obs_properties_t *mssppts = obs_properties_create();
@@ -922,6 +811,16 @@ static obs_properties_t *switcher_properties(void *data)
 	prop_list_add_switch_to(p);
 	obs_properties_add_group(ppts, S_MEDIA_STATE_SWITCH, obs_module_text("MediaStateSwitch"), OBS_GROUP_CHECKABLE, mssppts);
 
+	const struct switcher_info *switcher = data;
+	if (switcher && switcher->audio_only) {
+		p = obs_properties_add_int(ppts, S_TRANSITION_DURATION, obs_module_text("Crossfade"), 0, 10000, 100);
+		obs_property_int_set_suffix(p, "ms");
+		obs_property_set_long_description(p, obs_module_text("CrossfadeDescription"));
+		return switcher_properties_file(ppts);
+	}
+	p = obs_properties_add_bool(ppts, S_RENDER_CACHE, obs_module_text("RenderCache"));
+	obs_property_set_long_description(p, obs_module_text("RenderCacheDescription"));
+
 	obs_properties_t *transition_group = obs_properties_create();
 
 	p = obs_properties_add_list(transition_group, S_TRANSITION, obs_module_text("TransitionType"), OBS_COMBO_TYPE_LIST,
@@ -954,7 +853,13 @@ static obs_properties_t *switcher_properties(void *data)
 		obs_property_list_add_string(hp, name, id);
 	}
 	obs_properties_add_group(ppts, S_TRANSITION_GROUP, obs_module_text("Transition"), OBS_GROUP_NORMAL, transition_group);
+	return switcher_properties_file(ppts);
+}
 
+/* current source file group and plugin info, shared by both switcher types */
+static obs_properties_t *switcher_properties_file(obs_properties_t *ppts)
+{
+	obs_property_t *p;
 	obs_properties_t *file_group = obs_properties_create();
 
 	obs_properties_add_path(file_group, S_CURRENT_SOURCE_FILE_PATH, obs_module_text("File"), OBS_PATH_FILE_SAVE,
@@ -962,6 +867,9 @@ static obs_properties_t *switcher_properties(void *data)
 				"All Files (*.*)",
 				NULL);
 
+	p = obs_properties_add_bool(file_group, S_CURRENT_SOURCE_FILE_WATCH, obs_module_text("WatchFile"));
+	obs_property_set_long_description(p, obs_module_text("WatchFileDescription"));
+
 	p = obs_properties_add_int(file_group, S_CURRENT_SOURCE_FILE_INTERVAL, obs_module_text("ReadInterval"), 0, 100000, 100);
 	obs_property_int_set_suffix(p, "ms");
 
@@ -981,6 +889,13 @@ void switcher_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, S_LOG, false);
 	obs_data_set_default_bool(settings, S_LOOP, true);
+	obs_data_set_default_int(settings, S_LOOKAHEAD, 0);
+	obs_data_set_default_int(settings, S_RANDOM_SEED, 0);
+	obs_data_set_default_int(settings, S_WARM_POOL, 0);
+	obs_data_set_default_int(settings, S_WARM_POOL_BUDGET, 0);
+	obs_data_set_default_int(settings, S_LATENCY_LOG_INTERVAL, 0);
+	obs_data_set_default_int(settings, S_HOTKEY_LIMIT, 0);
+	obs_data_set_default_bool(settings, S_RENDER_CACHE, false);
 
 	obs_data_set_default_int(settings, S_TIME_SWITCH_DURATION, 5000);
 	obs_data_set_default_int(settings, S_TIME_SWITCH_BETWEEN, 0);
@@ -995,76 +910,26 @@ void switcher_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, S_TRANSITION_RESIZE, true);
 }
 
-uint32_t switcher_get_width(void *data)
-{
-	struct switcher_info *switcher = data;
-	if (switcher_transition_active(switcher->current_transition)) {
-		if (switcher->transition_resize) {
-			obs_source_t *source_a = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_A);
-			obs_source_t *source_b = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_B);
-			uint32_t cxa = 0;
-			uint32_t cxb = 0;
-			if (source_a) {
-				cxa = obs_source_get_width(source_a);
-			}
-			if (source_b) {
-				cxb = obs_source_get_width(source_b);
-			}
-			const float t = obs_transition_get_time(switcher->current_transition);
-			const uint32_t cx = (cxa && cxb) ? (uint32_t)((1.0f - t) * (float)cxa + t * (float)cxb) : cxa + cxb;
-			obs_source_release(source_a);
-			obs_source_release(source_b);
-			return cx;
-		}
-		return obs_source_get_width(switcher->current_transition);
-	}
-	if (switcher->current_source)
-		return obs_source_get_width(switcher->current_source);
-	return 0;
-}
-
-uint32_t switcher_get_height(void *data)
-{
-	struct switcher_info *switcher = data;
-	if (switcher_transition_active(switcher->current_transition)) {
-		if (switcher->transition_resize) {
-			obs_source_t *source_a = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_A);
-			obs_source_t *source_b = obs_transition_get_source(switcher->current_transition, OBS_TRANSITION_SOURCE_B);
-			uint32_t cya = 0;
-			uint32_t cyb = 0;
-			if (source_a) {
-				cya = obs_source_get_height(source_a);
-			}
-			if (source_b) {
-				cyb = obs_source_get_height(source_b);
-			}
-			const float t = obs_transition_get_time(switcher->current_transition);
-			const uint32_t cy = (cya && cyb) ? (uint32_t)((1.0f - t) * (float)cya + t * (float)cyb) : cya + cyb;
-			obs_source_release(source_a);
-			obs_source_release(source_b);
-			return cy;
-		}
-		return obs_source_get_height(switcher->current_transition);
-	}
-	if (switcher->current_source)
-		return obs_source_get_height(switcher->current_source);
-	return 0;
-}
-
 static void switcher_enum_active_sources(void *data, obs_source_enum_proc_t enum_callback, void *param)
 {
 	struct switcher_info *switcher = data;
-	if (switcher_transition_active(switcher->current_transition)) {
+	if (switcher->current_transition)
 		enum_callback(switcher->source, switcher->current_transition, param);
-	} else if (switcher->transition && switcher->transition_running == TRANSITION_NORMAL) {
-		enum_callback(switcher->source, switcher->transition, param);
-	} else if (switcher->show_transition && switcher->transition_running == TRANSITION_SHOW) {
-		enum_callback(switcher->source, switcher->show_transition, param);
-	} else if (switcher->hide_transition && switcher->transition_running == TRANSITION_HIDE) {
-		enum_callback(switcher->source, switcher->hide_transition, param);
-	}
+	/* the tick releases the faded out source once the fade is done */
+	pthread_mutex_lock(&switcher->audio_fade_mutex);
+	if (switcher->audio_fade_source)
+		enum_callback(switcher->source, switcher->audio_fade_source, param);
+	pthread_mutex_unlock(&switcher->audio_fade_mutex);
 	if (switcher->current_source)
 		enum_callback(switcher->source, switcher->current_source, param);
+	/* the lookahead keeps these active so they have frames by the time they are shown */
+	pthread_mutex_lock(&switcher->children_mutex);
+	for (size_t i = 0; i < switcher->preloaded.num; i++)
+		enum_callback(switcher->source, switcher->preloaded.array[i], param);
+	/* sources shown recently stay active in the warm pool */
+	for (size_t i = 0; i < switcher->warm_pool.num; i++)
+		enum_callback(switcher->source, switcher->warm_pool.array[i], param);
+	pthread_mutex_unlock(&switcher->children_mutex);
 }
 
 static void switcher_enum_all_sources(void *data, obs_source_enum_proc_t enum_callback, void *param)
@@ -1079,92 +944,8 @@ static void switcher_enum_all_sources(void *data, obs_source_enum_proc_t enum_ca
 	if (!current_found && switcher->current_source) {
 		enum_callback(switcher->source, switcher->current_source, param);
 	}
-	if (switcher_transition_active(switcher->current_transition)) {
+	if (switcher->current_transition)
 		enum_callback(switcher->source, switcher->current_transition, param);
-	} else if (switcher->transition && switcher->transition_running == TRANSITION_NORMAL) {
-		enum_callback(switcher->source, switcher->transition, param);
-	} else if (switcher->show_transition && switcher->transition_running == TRANSITION_SHOW) {
-		enum_callback(switcher->source, switcher->show_transition, param);
-	} else if (switcher->hide_transition && switcher->transition_running == TRANSITION_HIDE) {
-		enum_callback(switcher->source, switcher->hide_transition, param);
-	}
-}
-
-void switcher_video_tick(void *data, float seconds)
-{
-	UNUSED_PARAMETER(seconds);
-	struct switcher_info *switcher = data;
-	if (switcher->time_switch && switcher->state == OBS_MEDIA_STATE_PLAYING) {
-		const uint64_t t = obs_get_video_frame_time();
-		if (switcher->current_source == NULL) {
-			if (t > switcher->last_switch_time &&
-			    t - switcher->last_switch_time > switcher->time_switch_between * 1000000UL) {
-				switcher_switch_to(switcher, switcher->time_switch_to);
-			}
-		} else {
-			if (t > switcher->last_switch_time &&
-			    t - switcher->last_switch_time > switcher->time_switch_duration * 1000000UL) {
-				if (switcher->time_switch_between > 0) {
-					switcher_switch_to(switcher, SWITCH_NONE);
-				} else {
-					switcher_switch_to(switcher, switcher->time_switch_to);
-				}
-			}
-		}
-	}
-	if (switcher->media_state_switch && switcher->current_source) {
-		const uint64_t t = obs_get_video_frame_time();
-		const enum obs_media_state state = obs_source_media_get_state(switcher->current_source);
-		if (state != OBS_MEDIA_STATE_NONE &&
-		    (t < switcher->last_switch_time ||
-		     t - switcher->last_switch_time > 10000000UL)) { // wait 10 ms before start checking state
-			if (switcher->media_switch_state < 0) {
-				if (-switcher->media_switch_state != (int32_t)state) {
-					switcher_switch_to(switcher, switcher->media_state_switch_to);
-				}
-			} else if (switcher->media_switch_state == (int32_t)state) {
-				switcher_switch_to(switcher, switcher->media_state_switch_to);
-			} else if (state == OBS_MEDIA_STATE_PLAYING && switcher->media_switch_state == OBS_MEDIA_STATE_ENDED &&
-				   switcher->transition_running == TRANSITION_NONE) {
-				const int64_t duration = obs_source_media_get_duration(switcher->current_source);
-				if (duration) {
-					const int64_t time = obs_source_media_get_time(switcher->current_source);
-					if (time <= duration && duration - time < (int64_t)switcher->transition_duration) {
-						switcher_switch_to(switcher, switcher->media_state_switch_to);
-					}
-				}
-			}
-		}
-	}
-	if (switcher->current_source_file && switcher->current_source_file_interval > 0 && switcher->current_source_file_path &&
-	    strlen(switcher->current_source_file_path)) {
-		switcher->current_source_file_duration += seconds;
-		if (switcher->current_source_file_duration * 1000.0f > switcher->current_source_file_interval) {
-			switcher->current_source_file_duration = 0.0f;
-			char *source_name = os_quick_read_utf8_file(switcher->current_source_file_path);
-			if (source_name) {
-				if (strlen(source_name) == 0) {
-					if (switcher->current_source) {
-						switcher_switch_to(switcher, SWITCH_NONE);
-					}
-				} else if (switcher->current_source &&
-					   strcmp(obs_source_get_name(switcher->current_source), source_name) == 0) {
-				} else {
-					for (size_t i = 0; i < switcher->sources.num; i++) {
-						if (strcmp(obs_source_get_name(switcher->sources.array[i]), source_name) == 0) {
-							if (switcher->current_index != i) {
-								switcher->last_switch_time = obs_get_video_frame_time();
-								switcher->current_index = i;
-								switcher_index_changed(switcher);
-							}
-							break;
-						}
-					}
-				}
-				bfree(source_name);
-			}
-		}
-	}
 }
 
 void switcher_save(void *data, obs_data_t *settings)
@@ -1201,96 +982,110 @@ void switcher_save(void *data, obs_data_t *settings)
 	}
 }
 
-void switcher_load(void *data, obs_data_t *settings)
+/* load and update get the source's own settings, the commands read them back when they run */
+static void switcher_load_command(struct switcher_info *switcher, const struct switcher_command *command)
 {
-	struct switcher_info *switcher = data;
+	UNUSED_PARAMETER(command);
+	obs_data_t *settings = obs_source_get_settings(switcher->source);
 	const long long index = obs_data_get_int(settings, "current_index");
 	if (index >= 0) {
 		switcher->current_index = (size_t)index;
-		switcher_update(data, settings);
+		switcher_update(switcher, settings);
 	} else {
-		switcher_update(data, settings);
+		switcher_update(switcher, settings);
 		switcher_switch_to(switcher, SWITCH_NONE);
 	}
+	obs_data_release(settings);
 }
 
-static void switcher_play_pause(void *data, bool pause)
+void switcher_load(void *data, obs_data_t *settings)
 {
-	struct switcher_info *switcher = data;
-	if (pause) {
-		switcher->state = OBS_MEDIA_STATE_PAUSED;
-	} else {
-		switcher->state = OBS_MEDIA_STATE_PLAYING;
-	}
+	UNUSED_PARAMETER(settings);
+	struct switcher_command command = {.proc = switcher_load_command, .keep = true};
+	switcher_post_command(data, &command);
 }
 
-static void switcher_restart(void *data)
+static void switcher_update_command(struct switcher_info *switcher, const struct switcher_command *command)
 {
-	struct switcher_info *switcher = data;
-	switcher_switch_to(switcher, SWITCH_FIRST);
-	switcher->state = OBS_MEDIA_STATE_PLAYING;
+	UNUSED_PARAMETER(command);
+	obs_data_t *settings = obs_source_get_settings(switcher->source);
+	switcher_update(switcher, settings);
+	obs_data_release(settings);
 }
 
-static void switcher_stop(void *data)
+/* libobs defers updates of video sources to their video tick, the audio switcher is updated on the caller's thread */
+static void switcher_audio_update(void *data, obs_data_t *settings)
 {
-	struct switcher_info *switcher = data;
-	switcher_switch_to(switcher, SWITCH_NONE);
-	switcher->state = OBS_MEDIA_STATE_STOPPED;
+	UNUSED_PARAMETER(settings);
+	struct switcher_command command = {.proc = switcher_update_command, .keep = true};
+	switcher_post_command(data, &command);
 }
 
-static void switcher_next_slide(void *data)
+static void switcher_media_command(struct switcher_info *switcher, const struct switcher_command *command)
 {
-	struct switcher_info *switcher = data;
-	switcher_switch_to(switcher, SWITCH_NEXT);
+	if (command->switch_to >= 0) {
+		switcher->switch_origin = command->origin;
+		switcher->switch_posted = command->posted;
+		switcher_switch_to(switcher, command->switch_to);
+	}
+	if (command->state != OBS_MEDIA_STATE_NONE)
+		switcher->state = command->state;
 }
 
-static void switcher_previous_slide(void *data)
+static void switcher_post_media(struct switcher_info *switcher, int32_t switch_to, enum obs_media_state state)
 {
-	struct switcher_info *switcher = data;
-	switcher_switch_to(switcher, SWITCH_PREVIOUS);
+	struct switcher_command command = {
+		.proc = switcher_media_command,
+		.origin = SWITCHER_ORIGIN_MEDIA_CONTROL,
+		.switch_to = switch_to,
+		.state = state,
+	};
+	switcher_post_command(switcher, &command);
 }
 
-static enum obs_media_state switcher_get_state(void *data)
+static void switcher_play_pause(void *data, bool pause)
 {
-	struct switcher_info *switcher = data;
-	return switcher->state;
+	switcher_post_media(data, -1, pause ? OBS_MEDIA_STATE_PAUSED : OBS_MEDIA_STATE_PLAYING);
 }
 
-static int64_t switcher_get_duration(void *data)
+static void switcher_restart(void *data)
 {
-	struct switcher_info *switcher = data;
-	if (switcher->time_switch && (switcher->time_switch_duration + switcher->time_switch_between) > 0)
-		return (switcher->time_switch_duration + switcher->time_switch_between) * switcher->sources.num;
+	switcher_post_media(data, SWITCH_FIRST, OBS_MEDIA_STATE_PLAYING);
+}
 
-	return (int64_t)1000 * switcher->sources.num;
+static void switcher_stop(void *data)
+{
+	switcher_post_media(data, SWITCH_NONE, OBS_MEDIA_STATE_STOPPED);
 }
 
-static int64_t switcher_get_time(void *data)
+static void switcher_next_slide(void *data)
 {
-	struct switcher_info *switcher = data;
-	if (!switcher->time_switch)
-		return (int64_t)1000 * switcher->current_index;
-	uint64_t t = obs_get_video_frame_time();
-	if (t <= switcher->last_switch_time)
-		return (switcher->time_switch_duration + switcher->time_switch_between) * switcher->current_index;
+	switcher_post_switch(data, SWITCHER_ORIGIN_MEDIA_CONTROL, SWITCH_NEXT);
+}
 
-	uint64_t duration = (t - switcher->last_switch_time) / 1000000UL;
-	if (duration < (switcher->time_switch_duration + switcher->time_switch_between))
-		return (switcher->time_switch_duration + switcher->time_switch_between) * switcher->current_index + duration;
+static void switcher_previous_slide(void *data)
+{
+	switcher_post_switch(data, SWITCHER_ORIGIN_MEDIA_CONTROL, SWITCH_PREVIOUS);
+}
+
+static void switcher_seek_command(struct switcher_info *switcher, const struct switcher_command *command)
+{
+	switcher_set_time(switcher, command->index);
+}
 
-	return (switcher->time_switch_duration + switcher->time_switch_between) * (switcher->current_index + 1);
+static void switcher_media_set_time(void *data, int64_t ms)
+{
+	struct switcher_command command = {
+		.proc = switcher_seek_command,
+		.index = ms,
+	};
+	switcher_post_command(data, &command);
 }
 
-static void switcher_set_time(void *data, int64_t ms)
+static enum obs_media_state switcher_get_state(void *data)
 {
 	struct switcher_info *switcher = data;
-	switcher->last_switch_time = obs_get_video_frame_time();
-	if (switcher->time_switch && (switcher->time_switch_duration + switcher->time_switch_between) > 0) {
-		switcher->current_index = (int32_t)(ms / (switcher->time_switch_duration + switcher->time_switch_between));
-	} else {
-		switcher->current_index = (int32_t)(ms / 1000);
-	}
-	switcher_index_changed(switcher);
+	return switcher->state;
 }
 
 struct obs_source_info source_switcher = {
@@ -1323,7 +1118,36 @@ struct obs_source_info source_switcher = {
 	/* We reuse time slider for progress */
 	.media_get_duration = switcher_get_duration,
 	.media_get_time = switcher_get_time,
-	.media_set_time = switcher_set_time,
+	.media_set_time = switcher_media_set_time,
+};
+
+/* same switcher without the video path, for music beds and other audio only sources */
+struct obs_source_info audio_source_switcher = {
+	.id = "audio_source_switcher",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_COMPOSITE | OBS_SOURCE_DO_NOT_DUPLICATE | OBS_SOURCE_CONTROLLABLE_MEDIA,
+	.get_name = switcher_audio_get_name,
+	.create = switcher_audio_create,
+	.destroy = switcher_destroy,
+	.update = switcher_audio_update,
+	.audio_render = switcher_audio_render,
+	.get_properties = switcher_properties,
+	.get_defaults = switcher_defaults,
+	.enum_active_sources = switcher_enum_active_sources,
+	.enum_all_sources = switcher_enum_all_sources,
+	.video_tick = switcher_video_tick,
+	.save = switcher_save,
+	.load = switcher_load,
+	.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT,
+	.media_play_pause = switcher_play_pause,
+	.media_restart = switcher_restart,
+	.media_stop = switcher_stop,
+	.media_next = switcher_next_slide,
+	.media_previous = switcher_previous_slide,
+	.media_get_state = switcher_get_state,
+	.media_get_duration = switcher_get_duration,
+	.media_get_time = switcher_get_time,
+	.media_set_time = switcher_media_set_time,
 };
 
 OBS_DECLARE_MODULE()
@@ -1342,6 +1166,21 @@ MODULE_EXPORT const char *obs_module_name(void)
 bool obs_module_load(void)
 {
 	blog(LOG_INFO, "[Source Switcher] loaded version %s", PROJECT_VERSION);
+	switcher_registry_init();
+	switcher_watch_init();
+	switcher_writer_init();
+	signal_handler_connect(obs_get_signal_handler(), "source_rename", switcher_source_rename, NULL);
 	obs_register_source(&source_switcher);
+	obs_register_source(&audio_source_switcher);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	signal_handler_disconnect(obs_get_signal_handler(), "source_rename", switcher_source_rename, NULL);
+	switcher_watch_free();
+	switcher_writer_free();
+	blog(LOG_INFO, "[Source Switcher] current source file: %ld writes, %ld coalesced", switcher_writer_written(),
+	     switcher_writer_coalesced());
+	switcher_registry_free();
+}
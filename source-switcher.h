@@ -2,12 +2,20 @@
 
 #define S_SOURCES "sources"
 #define S_LOG "log"
+#define S_LATENCY_LOG_INTERVAL "latency_log_interval"
 #define S_LOOP "loop"
+#define S_LOOKAHEAD "lookahead"
+#define S_RANDOM_SEED "random_seed"
+#define S_WARM_POOL "warm_pool"
+#define S_WARM_POOL_BUDGET "warm_pool_budget"
+#define S_RENDER_CACHE "render_cache"
+#define S_HOTKEY_LIMIT "hotkey_limit"
 
 #define S_TIME_SWITCH "time_switch"
 #define S_TIME_SWITCH_DURATION "time_switch_duration"
 #define S_TIME_SWITCH_BETWEEN "time_switch_between"
 #define S_TIME_SWITCH_TO "time_switch_to"
+#define S_USE_MEDIA_DURATION "use_media_duration"
 
 #define S_MEDIA_SWITCH_STATE "media_switch_state"
 #define S_MEDIA_STATE_SWITCH "media_state_switch"
@@ -28,6 +36,7 @@
 #define S_CURRENT_SOURCE_FILE "current_source_file"
 #define S_CURRENT_SOURCE_FILE_PATH "current_source_file_path"
 #define S_CURRENT_SOURCE_FILE_INTERVAL "current_source_file_interval"
+#define S_CURRENT_SOURCE_FILE_WATCH "current_source_file_watch"
 
 #define SWITCH_NONE 0
 #define SWITCH_NEXT 1
@@ -35,6 +44,7 @@
 #define SWITCH_FIRST 3
 #define SWITCH_LAST 4
 #define SWITCH_RANDOM 5
+#define SWITCH_SHUFFLE 6
 
 #define TRANSITION_NONE 0
 #define TRANSITION_NORMAL 1